@@ -0,0 +1,95 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <memory>
+#include <functional>
+#include "db/Connection.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+
+// [新增] 异步 MySQL 连接
+// 用 MariaDB 的非阻塞接口 (mysql_stmt_execute_start/_cont) 驱动预编译语句：库需要等 socket 时就把 fd 挂到
+// 所属 EventLoop 的 Epoll 上，就绪后再继续，线程不会阻塞在一次网络往返上。
+// [修改] 只支持不取结果集的更新语句 (离线消息的写入和删除)；查询仍然走连接池的同步连接。
+// 没有非阻塞接口时 (Oracle libmysqlclient) 退化为在 loop 线程里阻塞执行，对调用者来说仍然是异步回调。
+// 一条 MySQL 连接同一时刻只能有一个查询在执行，后面的请求在本连接上排队，按提交顺序执行。
+// 所有成员函数都只能在所属 loop 线程中调用。
+// [新增] 连接断开 (服务器重启、网络中断) 后，排队的请求以失败结束，并在 loop 上定时重连。
+class AsyncConnection : public Channel {
+public:
+    // 更新完成：ok 表示是否成功，insertId 为自增主键 (INSERT 时有意义)
+    // [修改] connLost 为 true 表示失败是因为连接断了 (语句本身没问题，换条连接或重连后可以重试)
+    using UpdateCallback = std::function<void(bool ok, unsigned long long insertId, bool connLost)>;
+
+    // 一个待执行的请求：预编译语句 + 参数 (走二进制协议)
+    struct Request {
+        UpdateCallback onUpdate;
+        const StmtDef* stmt = nullptr;
+        StmtParams params;
+    };
+
+    explicit AsyncConnection(EventLoop* loop);
+    ~AsyncConnection();
+
+    // 建立连接 (阻塞)，在 loop 开始运行之前调用
+    // [修改] 失败时也保留参数，之后在 loop 上定时重连
+    bool connect(const std::string& ip, unsigned short port, const std::string& user,
+                 const std::string& password, const std::string& dbname);
+
+    // 提交一个请求，空闲时立即开始执行
+    void execute(Request req);
+
+    // 排队中 + 正在执行的请求数，用来挑选最空闲的连接
+    size_t pendingCount() const { return pending_.size() + (state_ == State::Idle ? 0 : 1); }
+
+    // 连接已经被服务器断开 (正在等待重连)
+    bool isBroken() const { return broken_; }
+
+    // socket 就绪 (Epoll 回调)
+    void handleEvent(uint32_t revents) override;
+
+private:
+    enum class State {
+        Idle,          // 没有请求在执行
+        Querying,      // 等待 mysql_stmt_execute 完成
+    };
+
+    // 空闲时依次取出排队的请求开始执行
+    void startNext();
+    // status 为库返回的等待标志：非 0 就按它注册事件等待，0 表示这一步完成了，推进到下一步
+    void advance(int status);
+    // 等待的事件/超时到了，继续执行库的状态机
+    void resume(int ready);
+    // 当前请求结束，执行回调 (connLost 见 UpdateCallback)
+    void complete(bool ok, bool connLost = false);
+    // 修改在 Epoll 上关注的事件
+    void setEvents(uint32_t events);
+    // 连接断开：当前和排队的请求全部以失败结束，然后安排重连
+    void markBroken();
+    // [新增] 当前请求失败：按错误码判断是不是连接断了，是的话整个转入 markBroken，否则只结束这一个请求
+    void fail(unsigned int err);
+    // [新增] 重新建立连接 (阻塞一次握手)，失败就过一会儿再试
+    void reconnect();
+
+    // [新增] 两次重连之间的间隔 (秒)
+    static constexpr double kReconnectDelay = 1.0;
+
+    EventLoop* loop_;
+    std::unique_ptr<Connection> conn_; // [修改] 重连时整个换掉 (预编译语句缓存随旧连接一起作废)
+    std::string ip_;
+    unsigned short port_;
+    std::string user_;
+    std::string password_;
+    std::string dbname_;
+    int fd_;
+    bool registered_;    // fd 是否已经加入 Epoll
+    uint32_t events_;    // 当前在 Epoll 上关注的事件
+    bool broken_;
+
+    State state_;
+    Request current_;
+    std::deque<Request> pending_;
+    MYSQL_STMT* stmt_;   // [新增] 当前请求的预编译语句
+    int error_;          // mysql_stmt_execute 的返回值
+    EventLoop::TimerId timer_; // 库要求的超时定时器
+};
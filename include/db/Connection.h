@@ -1,7 +1,14 @@
 #pragma once
 #include <mysql/mysql.h>
 #include <string>
+#include <vector>
 #include <ctime>
+#include "db/Statement.h"
+
+// [新增] MariaDB Connector/C 提供 mysql_*_start/_cont 非阻塞接口，Oracle 的 libmysqlclient 没有
+#if defined(LIBMARIADB) || defined(MARIADB_BASE_VERSION)
+#define DB_HAS_NONBLOCK_API 1
+#endif
 
 class Connection {
 public:
@@ -11,6 +18,12 @@ public:
     // 连接数据库
     bool connect(std::string ip, unsigned short port, std::string user, std::string password, std::string dbname);
 
+    // [新增] 开启非阻塞模式 (MariaDB 的 mysql_*_start/_cont 接口需要)，必须在 connect 之前调用
+    void setNonBlocking();
+
+    // [新增] 原生句柄，给异步连接驱动状态机用
+    MYSQL* getHandle() const { return conn_; }
+
     // 执行更新操作 (Insert, Update, Delete)
     bool update(std::string sql);
 
@@ -20,12 +33,27 @@ public:
     // 执行查询操作 (Select)
     MYSQL_RES* query(std::string sql);
 
+    // [新增] 取本连接上缓存的预编译语句：同一个 id 只在第一次使用时 prepare，失败返回 nullptr
+    // 语句统一登记在 server/model/SqlStatements.hpp
+    MYSQL_STMT* prepare(const StmtDef& def);
+
+    // [新增] 执行预编译的更新语句 (Insert, Update, Delete)，参数走二进制协议，不拼接 SQL
+    // insertId 非空时带回自增主键 (预编译语句的主键要从语句句柄上取，getInsertId 拿不到)
+    bool execute(const StmtDef& def, StmtParams& params, unsigned long long* insertId = nullptr);
+
+    // [新增] 执行预编译的查询语句，结果用返回的 StmtReader 逐行读取
+    StmtReader query(const StmtDef& def, StmtParams& params);
+
     // 刷新一下连接的起始空闲时间点
     void refreshAliveTime() { alivetime_ = clock(); }
     // 返回存活的时间
     clock_t getAliveTime() const { return clock() - alivetime_; }
 
 private:
+    // [新增] 绑定参数并执行，成功返回语句句柄
+    MYSQL_STMT* run(const StmtDef& def, StmtParams& params);
+
     MYSQL* conn_; // MySQL 原生句柄
+    std::vector<MYSQL_STMT*> stmts_; // [新增] 预编译语句缓存，下标是语句 id
     clock_t alivetime_; // 记录进入空闲状态后的起始时间
 };
\ No newline at end of file
@@ -9,7 +9,10 @@
 #include <memory>
 #include <functional>
 
+#include <vector>
+
 #include "db/Connection.h"
+#include "db/AsyncConnection.h"
 
 /*
 实现连接池功能模块
@@ -23,6 +26,23 @@ public:
     // 智能指针自动管理生命周期，用完自动归还到队列，而不是 delete
     std::shared_ptr<Connection> getConnection();
 
+    // 扫描超过 maxIdleTime 时间的空闲连接，进行回收连接
+    // [修改] 不再单独起一个睡眠线程，由服务器的定时器周期触发，在 DB 通道的线程上执行 (会阻塞在关连接上)
+    void scanIdleConnections();
+
+    // 空闲连接的最大存活时间 (秒)，也就是 scanIdleConnections 的调用周期
+    int getMaxIdleTime() const { return maxIdleTime_; }
+
+    // [新增] 异步执行预编译的更新语句 (任意线程可调用，立即返回)
+    // 请求交给数据库 IO 线程上的异步连接执行，完成后在该线程里调用 cb，回调里不要做阻塞操作。
+    // orderKey >= 0 时，相同 orderKey 的请求总是落在同一条连接上，按提交顺序执行
+    // (例如同一个用户的离线消息；[修改] 这条连接断开重连期间请求以 connLost 失败，不会顺延到别的连接而乱序)；
+    // 否则挑当前排队最少、没有断开的连接。
+    // 配置里 asyncSize=0 时没有异步连接，退化为在调用线程里同步执行
+    // def 必须是静态存储期的语句定义 (见 server/model/SqlStatements.hpp)，参数整个移交给数据库 IO 线程
+    void asyncExecute(const StmtDef& def, StmtParams params,
+                      AsyncConnection::UpdateCallback cb = nullptr, int orderKey = -1);
+
 private:
     // 单例模式：构造函数私有化
     ConnectionPool();
@@ -33,8 +53,10 @@ private:
     // 运行在独立的线程中，专门负责生产新连接
     void produceConnectionTask();
 
-    // 扫描超过 maxIdleTime 时间的空闲连接，进行回收连接
-    void scannerConnectionTask();
+    // [新增] 创建异步连接并启动数据库 IO 线程
+    void startAsync();
+    // [新增] 在数据库 IO 线程里为请求挑一条异步连接
+    AsyncConnection* pickAsyncConnection(int orderKey);
 
     std::string ip_;
     unsigned short port_;
@@ -46,9 +68,14 @@ private:
     int maxSize_;       // 连接池的最大连接量
     int maxIdleTime_;   // 连接池最大空闲时间
     int connectionTimeout_; // 连接池获取连接的超时时间
+    int asyncSize_;     // [新增] 异步连接数量
 
     std::queue<Connection*> connectionQueue_; // 存储mysql连接的队列
     std::mutex queueMutex_; // 维护连接队列线程安全的互斥锁
     std::atomic_int connectionCnt_; // 记录连接所创建的connection连接的总数量 
     std::condition_variable cv_; // 设置条件变量，用于连接生产线程和消费线程的通信
+
+    // [新增] 数据库 IO 线程的事件循环，以及挂在上面的异步连接 (只在该线程访问)
+    std::unique_ptr<EventLoop> asyncLoop_;
+    std::vector<std::unique_ptr<AsyncConnection>> asyncConns_;
 };
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <thread>
 #include <functional>
 #include <string>
+#include <vector>
+#include "db/RedisPublisher.h"
 
 class Redis {
 public:
@@ -15,27 +17,47 @@ public:
     bool connect();
 
     // 向redis指定的通道channel发布消息
-    bool publish(int channel, std::string message);
+    // [修改] 异步发送：放入发送队列立即返回，由 RedisPublisher 批量 pipeline 发出；任意线程都可以调用
+    // [修改] 通道按节点划分，不再是一个用户一个通道：接收者 userid 放在消息信封里 (4 字节网络序 + 原始数据)
+    // 数据按二进制发送，protobuf 里的 '\0' 不会截断消息
+    bool publish(const std::string& channel, int userid, const std::string& message);
 
     // 向redis指定的通道subscribe订阅消息
-    bool subscribe(int channel);
+    // [修改] 每个节点只订阅自己的通道，启动时订阅一次，登录/下线不再订阅/取消订阅
+    // [修改] 订阅成功后才启动接收线程；hiredis 上下文不能两个线程同时用，接收线程启动之后不能再订阅
+    bool subscribe(const std::string& channel);
 
-    // 向redis指定的通道unsubscribe取消订阅消息
-    bool unsubscribe(int channel);
+    // 向redis指定的通道unsubscribe取消订阅消息 (同样只能在接收线程启动之前调用)
+    bool unsubscribe(const std::string& channel);
 
     // 在独立线程中接收订阅通道中的消息
+    // [修改] 连接断开后重连并重新订阅，不会就此退出 (否则本节点租约还在续，别的节点发来的消息全部丢失)
     void observer_channel_message();
 
-    // 初始化向业务层上报通道消息的回调对象
+    // 初始化向业务层上报通道消息的回调对象 (参数为信封里的接收者 userid 和消息)
     void init_notify_handler(std::function<void(int, std::string)> fn);
 
+    // [新增] 初始化没有送达的消息的回调对象 (目标通道上没有订阅者，参数同上)，需在 connect 之前调用
+    void init_undelivered_handler(std::function<void(int, std::string)> fn);
+
 private:
-    // hiredis同步上下文对象，负责reply
-    redisContext *_publish_context;
+    // [修改] 负责 publish 的连接池 (原来是一个被所有业务线程无锁共用的同步上下文)
+    static constexpr size_t kPublishContexts = 4;
+    RedisPublisher _publisher;
+
+    // [新增] 重连订阅连接的间隔 (秒)
+    static constexpr double kReconnectDelay = 1.0;
+
+    // [新增] (重新) 建立订阅连接并订阅 _channels 里的所有通道，只在接收线程 (或它启动之前) 调用
+    bool resubscribe();
 
     // hiredis同步上下文对象，负责subscribe
     redisContext *_subcribe_context;
 
+    // [新增] 已订阅的通道 (重连后重新订阅) 和接收线程是否已经启动
+    std::vector<std::string> _channels;
+    bool _observing;
+
     // 回调操作，拿到订阅的消息后，给service层上报
     std::function<void(int, std::string)> _notify_message_handler;
 };
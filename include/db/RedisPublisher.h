@@ -0,0 +1,71 @@
+#pragma once
+#include <hiredis/hiredis.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+// [新增] 异步批量 PUBLISH
+// 持有一小组 Redis 连接，每条连接一个后台线程和一个发送队列。publish 只是入队 (任意线程可调用)，
+// 后台线程把攒下的命令用 redisAppendCommand 一次性写出去 (pipeline)，再依次读回复，
+// 一批命令只付一次往返，跨节点消息的吞吐不再受 Redis RTT 限制。
+// 同一个通道总是落在同一条连接上，所以发往同一节点的消息保持提交顺序。
+class RedisPublisher {
+public:
+    // [新增] PUBLISH 的回复是 0 (通道上没有订阅者，例如目标节点已经挂了) 时，把这条消息交还给调用者
+    // 在后台线程里调用，不要做阻塞操作
+    using UndeliveredCallback = std::function<void(std::string message)>;
+
+    RedisPublisher();
+    ~RedisPublisher();
+
+    RedisPublisher(const RedisPublisher&) = delete;
+    RedisPublisher& operator=(const RedisPublisher&) = delete;
+
+    // [新增] 设置没有送达的消息的处理函数，需在 start 之前调用
+    void setUndeliveredCallback(UndeliveredCallback cb) { undelivered_ = std::move(cb); }
+
+    // 建立 contexts 条连接并启动后台线程
+    bool start(const std::string& ip, int port, size_t contexts);
+
+    // 把一条 PUBLISH 放入发送队列，立即返回；队列积压超过上限 (Redis 长时间不可用) 时不入队并返回 false，
+    // 由调用者自行处理这条消息 (例如转存离线消息)；已经入队的发送失败会重连重试，不会丢弃
+    bool publish(const std::string& channel, std::string message);
+
+private:
+    struct Item {
+        std::string channel;
+        std::string message;
+    };
+
+    // 一条连接及其发送队列
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<Item> queue;
+        std::chrono::steady_clock::time_point firstAt; // queue 里第一条命令的入队时间
+        redisContext* context = nullptr;               // 只在后台线程里使用
+        bool stop = false;
+        std::thread thread;
+    };
+
+    // 后台线程：等够一批或者时间窗口到了就整批发出
+    void run(Worker* worker);
+    // 用 pipeline 发送一批命令 (连接出过错就先重连)
+    // [修改] 失败时返回 false，batch 里留下还没确认发出去的命令，由 run 放回队头重试
+    bool flush(Worker* worker, std::vector<Item>& batch);
+
+    static constexpr size_t kMaxBatch = 128;      // 攒够这么多条立即发送
+    static constexpr int kFlushWindowUs = 200;    // 第一条命令最多等这么久
+    static constexpr size_t kMaxQueue = 65536;    // 每条连接的积压上限
+    static constexpr int kRetryDelayMs = 1000;    // [新增] 发送失败后隔这么久重连重试
+
+    std::string ip_;
+    int port_;
+    UndeliveredCallback undelivered_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <mysql/mysql.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// [新增] 一条预编译语句：id 用来在每条连接上缓存 prepare 结果，同一个 id 只能对应一条 SQL
+struct StmtDef {
+    int id;
+    const char* sql;
+};
+
+// [新增] 预编译语句的参数
+// 参数值由本对象持有 (字符串也是拷贝/移动进来的)，所以可以整个交给异步连接在别的线程里执行
+class StmtParams {
+public:
+    StmtParams& addInt(long long value);
+    // 文本参数 (VARCHAR 等)
+    StmtParams& addString(std::string value);
+    // 二进制参数 (BLOB/VARBINARY)，按原样传输，不需要转义
+    StmtParams& addBlob(std::string value);
+
+    size_t size() const { return params_.size(); }
+
+    // 把参数绑定到语句上 (之后不能再 add，直到语句执行完)
+    bool bind(MYSQL_STMT* stmt);
+
+private:
+    struct Param {
+        enum_field_types type;
+        long long intValue;
+        std::string strValue;
+        unsigned long length;
+    };
+
+    std::vector<Param> params_;
+    std::vector<MYSQL_BIND> binds_;
+};
+
+// [新增] 逐行读取预编译查询语句的结果
+// 列先以 0 长度绑定，取到一行后再按每列的实际长度用 mysql_stmt_fetch_column 取出来，
+// 所以不需要事先知道列有多长，也不会被固定大小的缓冲区截断
+class StmtReader {
+public:
+    // stmt 为 nullptr 表示执行失败，没有结果
+    explicit StmtReader(MYSQL_STMT* stmt);
+    ~StmtReader();
+
+    StmtReader(StmtReader&& other) noexcept;
+    StmtReader(const StmtReader&) = delete;
+    StmtReader& operator=(const StmtReader&) = delete;
+    StmtReader& operator=(StmtReader&&) = delete;
+
+    // 移动到下一行，没有更多行时返回 false
+    bool next();
+
+    bool isNull(unsigned int col) const;
+    long long getInt(unsigned int col);
+    std::string getString(unsigned int col);
+
+private:
+    // MariaDB 是 my_bool，MySQL 8 是 bool，按头文件里的实际类型来
+    using NullFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+
+    // 每列的实际长度和是否为 NULL (不能用 vector<bool>，绑定需要真实的地址)
+    struct Column {
+        unsigned long length;
+        NullFlag isNull;
+    };
+
+    MYSQL_STMT* stmt_;
+    std::vector<MYSQL_BIND> binds_;
+    std::vector<Column> columns_;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <memory>
+#include <sys/types.h> // ssize_t
+
+// 发送缓冲区：由若干固定大小的块串成链表
+// 和 Buffer 一样每块维护 readIndex/writeIndex，部分写之后只需要移动下标或弹出整块，
+// 不会像 std::string::erase 那样把剩下的积压数据整体搬移一遍
+class ChainBuffer {
+public:
+    // 每块的大小
+    static constexpr size_t kBlockSize = 8192;
+    // 一次 writev 最多携带的块数
+    static constexpr int kMaxIov = 64;
+
+    ChainBuffer();
+    ~ChainBuffer() = default;
+
+    // 还有多少字节没发出去
+    size_t readableBytes() const { return readable_; }
+    bool empty() const { return readable_ == 0; }
+
+    // 追加数据 (拷贝到链尾的块里，不够就再挂新块)
+    void append(const char* data, size_t len);
+
+    // 标记前 len 个字节已经发出去了
+    void retrieve(size_t len);
+
+    // 用 writev 把多个块一次性写到 fd
+    // 返回写出的字节数，出错返回 -1 并把 errno 存到 saveErrno
+    ssize_t writeFd(int fd, int* saveErrno);
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t readIndex;
+        size_t writeIndex;
+    };
+
+    // 取一块空闲内存，优先复用之前释放的块
+    std::unique_ptr<char[]> allocBlock();
+    // 发完的块放回空闲列表 (只保留少量，避免空闲连接占内存)
+    void releaseBlock(std::unique_ptr<char[]> data);
+
+    std::deque<Block> blocks_;
+    std::vector<std::unique_ptr<char[]>> freeBlocks_;
+    size_t readable_;
+};
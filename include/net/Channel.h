@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// 注册到 Epoll 里的对象
+// epoll_event.data.ptr 直接指向它，事件到来时 EventLoop 只需一次指针解引用就能分发，
+// 不需要再拿 fd 去查表、加锁
+class Channel {
+public:
+    virtual ~Channel() = default;
+
+    // revents: epoll_wait 返回的就绪事件 (EPOLLIN / EPOLLOUT / EPOLLERR ...)
+    virtual void handleEvent(uint32_t revents) = 0;
+};
@@ -2,25 +2,46 @@
 
 #include <sys/epoll.h> //Linux 下 epoll 相关的头文件
 #include <vector>
+#include "net/Channel.h"
 
 class Epoll{
 
 public:
+    // [新增] poll 的返回值：指向 Epoll 内部事件数组的一段视图 (类似 span)
+    // 不拷贝、不分配内存，可以直接 for (auto& ev : epoll.poll()) 遍历
+    // 只在下一次调用 poll 之前有效
+    class EventList {
+    public:
+        EventList(const epoll_event* first, int count) : first_(first), count_(count) {}
+        const epoll_event* begin() const { return first_; }
+        const epoll_event* end() const { return first_ + count_; }
+        int size() const { return count_; }
+        bool empty() const { return count_ == 0; }
+    private:
+        const epoll_event* first_;
+        int count_;
+    };
+
     Epoll();
     ~Epoll();
 
     // 核心功能 1：把一个 Socket (fd) 加入监听名单
     // op: 你想干什么？(EPOLL_CTL_ADD 添加 / EPOLL_CTL_DEL 删除)
-    void updateChannel(int fd, int op, uint32_t events);
+    // channel: 存进 epoll_event.data.ptr，事件返回时直接拿到处理对象 (EPOLL_CTL_DEL 时可传 nullptr)
+    void updateChannel(int fd, int op, uint32_t events, Channel* channel);
 
     // 核心功能 2：等待事件发生
     // timeout: 等待多久？(-1 表示死等，直到有事发生)
     // 返回值：发生的一组事件 (比如：Socket A 有数据读，Socket B 断开了)
-    std::vector<epoll_event> poll(int timeout = -1);
+    // 事件直接存放在内部数组里，循环中不会有任何内存分配
+    EventList poll(int timeout = -1);
 
 
 private:
     int epollFd; // Epoll 的身份证号 (文件描述符)
-    struct epoll_event* events; // 这是一个数组，用来暂存刚才发生的事件
+    // 用来暂存刚才发生的事件；如果某次 epoll_wait 把数组填满了，
+    // 说明事件很多，下一次 poll 前自动扩容，大批量事件可以用更少的系统调用取完
+    std::vector<epoll_event> events;
+    bool eventsFull; // 上一次 poll 是否把数组填满了
 
-};
\ No newline at end of file
+};
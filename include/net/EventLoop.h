@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include "net/Epoll.h"
+#include "net/Channel.h"
+#include "net/MpscQueue.h"
+#include "net/TimingWheel.h"
+#include "net/TimerQueue.h"
+#include "net/TcpConnection.h"
+
+// 一个 EventLoop 对应一个线程 (one loop per thread)
+// 每个 EventLoop 拥有自己独立的 Epoll 和自己的连接表，互不干扰
+class EventLoop {
+public:
+    // 非连接类 fd (例如监听 Socket) 就绪时的回调
+    using FdCallback = std::function<void()>;
+    // 投递到 loop 线程执行的任务
+    using Functor = std::function<void()>;
+    // 定时器 id，用于取消；0 表示无效 id
+    using TimerId = TimerQueue::TimerId;
+
+    EventLoop();
+    ~EventLoop();
+
+    // 事件循环，在所属线程中一直运行
+    void loop();
+
+    Epoll* getEpoll() const { return epoll_.get(); }
+
+    // 当前线程是不是本 loop 所在的线程
+    bool isInLoopThread() const;
+
+    // 在 loop 线程中执行 cb：如果当前就是 loop 线程则立即执行，否则入队并唤醒 loop
+    void runInLoop(Functor cb);
+    // 把 cb 放入无锁队列，由 loop 线程在下一轮处理 (任意线程可调用)
+    void queueInLoop(Functor cb);
+
+    // [新增] 定时器 (任意线程可调用，回调总是在 loop 线程中执行)
+    // delay/interval 单位是秒，可以是小数 (例如 0.0005 表示 500 微秒)
+    TimerId runAfter(double delay, Functor cb);
+    TimerId runEvery(double interval, Functor cb);
+    void cancel(TimerId id);
+
+    // 注册一个非连接类 fd 的读事件回调，必须在 loop() 启动前调用
+    void registerFd(int fd, uint32_t events, FdCallback cb);
+
+    // 把新连接加入本 loop 的连接表并注册到 Epoll
+    // 任意线程可调用，真正的插入总是在 loop 线程里完成
+    void addConnection(const TcpConnection::ptr& conn);
+
+    // 从连接表中移除连接，返回被移除的连接 (不存在则返回 nullptr)，只能在 loop 线程调用
+    // 连接对象会一直保留到本轮事件处理完，保证同一批事件里的裸指针始终有效
+    TcpConnection::ptr removeConnection(int fd);
+
+    // 当前 loop 上的连接数 (任意线程可读，近似值)
+    size_t connectionCount() const { return connectionCount_.load(std::memory_order_relaxed); }
+
+    // [新增] 本 loop 的空闲检测时间轮 (每秒走一格)，只能在 loop 线程使用
+    // 超时时间由服务器在 loop 开始运行前设置 (TimingWheel::setTimeout)，0 表示不检测
+    TimingWheel& getIdleWheel() { return idleWheel_; }
+
+private:
+    // 非连接类 fd 对应的 Channel：事件到来时直接调用回调
+    class FdChannel : public Channel {
+    public:
+        explicit FdChannel(FdCallback cb) : cb_(std::move(cb)) {}
+        void handleEvent(uint32_t) override { cb_(); }
+    private:
+        FdCallback cb_;
+    };
+
+    // 在 loop 线程中真正插入连接
+    void addConnectionInLoop(const TcpConnection::ptr& conn);
+
+    // 写 eventfd，把阻塞在 epoll_wait 上的 loop 线程唤醒
+    void wakeup();
+    // eventfd 可读：清空计数并执行所有跨线程投递过来的任务
+    void handleWakeup();
+    // 每秒一次的定时器：推进空闲检测时间轮
+    void handleIdleTick();
+
+    std::unique_ptr<Epoll> epoll_;
+
+    // 用于跨线程唤醒的 eventfd，注册在本 loop 的 Epoll 上
+    int wakeupFd_;
+    // 已经有人写过 eventfd、loop 还没处理时为 true，避免每次 push 都做一次系统调用
+    std::atomic_bool wakeupPending_;
+    // 其他线程投递过来的任务 (MPSC 无锁队列，只有 loop 线程消费)
+    MpscQueue<Functor> pendingFunctors_;
+
+    // 定时器队列 (一个 timerfd + 最小堆)
+    TimerQueue timerQueue_;
+    // 空闲检测时间轮，由 timerQueue_ 上的周期定时器驱动
+    TimingWheel idleWheel_;
+
+    // 非连接类 fd 的 Channel，只在 loop() 启动前添加，生命周期跟随 EventLoop
+    std::vector<std::unique_ptr<FdChannel>> fdChannels_;
+
+    // 连接表：下标就是 fd，只在 loop 线程访问，所以不需要加锁，查找是 O(1)
+    std::vector<TcpConnection::ptr> connections_;
+    std::atomic<size_t> connectionCount_;
+    // 本轮事件处理中被关闭的连接，等整批事件处理完再释放
+    std::vector<TcpConnection::ptr> closingConnections_;
+};
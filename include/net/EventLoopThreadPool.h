@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <functional>
+#include "net/EventLoop.h"
+
+// Sub Reactor 线程池：每个线程跑一个 EventLoop
+// 主 Reactor 只负责 accept，然后通过 getNextLoop() 把连接轮询分发给某个 Sub Reactor
+class EventLoopThreadPool {
+public:
+    // loop 线程进入事件循环之前执行的初始化回调，index 是该 loop 的序号
+    using ThreadInitCallback = std::function<void(EventLoop*, int)>;
+
+    // numThreads 为 0 时退化为单 Reactor，所有连接都留在 baseLoop 上
+    EventLoopThreadPool(EventLoop* baseLoop, int numThreads);
+    ~EventLoopThreadPool();
+
+    // 创建并启动所有 Sub Reactor 线程
+    // cb 在每个 loop 所在线程里、loop() 启动之前执行 (单 Reactor 时对 baseLoop 在当前线程执行)
+    void start(const ThreadInitCallback& cb = ThreadInitCallback());
+
+    // loop 的总数 (单 Reactor 时为 1)
+    int size() const { return numThreads_ == 0 ? 1 : numThreads_; }
+
+    // 轮询选出下一个 Sub Reactor (只在主 Reactor 线程中调用)
+    EventLoop* getNextLoop();
+
+private:
+    EventLoop* baseLoop_;
+    int numThreads_;
+    size_t next_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+// 多生产者单消费者 (MPSC) 无锁队列 (Vyukov 算法)
+// 任意线程都可以 push，只有一个线程 (所属 EventLoop 线程) 可以 pop
+// push 只有一次原子 exchange，不会因为加锁而在扇出高峰时互相阻塞
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {
+        }
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 任意线程调用
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        // 先抢占队尾，再把前驱挂到新节点上
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 只能由消费者线程调用，队列为空时返回 false
+    // 注意：生产者刚 exchange 完还没挂上 next 时，这里也会暂时返回 false，
+    // 生产者在 push 完成后会负责唤醒消费者，所以不会丢消息
+    bool pop(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        value = std::move(next->value);
+        tail_ = next; // next 成为新的哨兵节点
+        delete tail;
+        return true;
+    }
+
+private:
+    struct Node {
+        Node() : next(nullptr) {}
+        explicit Node(T v) : value(std::move(v)), next(nullptr) {}
+        T value;
+        std::atomic<Node*> next;
+    };
+
+    // 生产者和消费者各自访问的指针放在不同的 cache line，避免伪共享
+    alignas(64) std::atomic<Node*> head_; // 生产者端
+    alignas(64) Node* tail_;              // 消费者端 (哨兵节点)
+};
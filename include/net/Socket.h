@@ -18,6 +18,12 @@ public:
     void listen();                            // 开始监听
     int accept(struct sockaddr_in* addr);                            // 接受连接 
 
+    // [新增] 开启 SO_REUSEPORT，多个监听 socket 可以绑定同一端口，由内核做负载均衡
+    // 必须在 bind 之前调用
+    void setReusePort(bool on);
+    // [新增] SO_INCOMING_CPU：让内核优先把在该 CPU 上收到的新连接交给这个监听 socket
+    void setIncomingCpu(int cpu);
+
     void setNonBlocking(); // 设置为非阻塞模式
     static void setNonBlocking(int fd);
 
@@ -2,53 +2,86 @@
 #include <memory>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <atomic>
-#include <mutex> // [修复] 补上 mutex 头文件
+#include <vector>
 #include "net/Socket.h" // 确保这些头文件里没有循环引用
 #include "net/Epoll.h"
+#include "net/Channel.h"
+#include "net/TimingWheel.h"
 #include "net/Buffer.h"
+#include "net/ChainBuffer.h"
+
+class EventLoop;
 
 // [关键修改] 继承 std::enable_shared_from_this
 // 这样我们在成员函数里就能通过 shared_from_this() 拿到管理自己的那个智能指针
-class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
+// 同时它也是一个 Channel：注册到 Epoll 时 data.ptr 直接指向连接对象本身
+// 也是时间轮上的一个节点：长时间没有数据时由所属 loop 的时间轮踢掉
+class TcpConnection : public Channel, public TimingWheel::Entry, public std::enable_shared_from_this<TcpConnection> {
 public:
     using ptr = std::shared_ptr<TcpConnection>;
     using CloseCallback = std::function<void(int)>;
 
-    TcpConnection(Epoll* epoll, int fd);
+    // loop: 该连接所属的 Sub Reactor，连接上的所有 IO 事件都在这个 loop 线程里处理
+    TcpConnection(EventLoop* loop, int fd);
     ~TcpConnection();
 
+    int getFd() const { return socket_->getFd(); }
+    EventLoop* getLoop() const { return loop_; }
+
+    // Epoll 事件分发入口 (只在所属 loop 线程调用)
+    void handleEvent(uint32_t revents) override;
+
     void onRead();
     void onWrite();
 
-    // [新增] 刷新最后活跃时间
-    void refreshAliveTime();
-    // [新增] 获取最后活跃时间
-    time_t getAliveTime() const { return lastActiveTime_; }
+    // 空闲超时 (时间轮回调，在 loop 线程中执行)
+    void onExpire() override;
 
-    // [新增] 发送数据的方法 (业务层会调用这个)
-    // 直接发送 string 数据
+    // [新增] 发送数据的方法 (业务层会调用这个，任意线程都可以调用)
+    // 直接发送 string 数据；不在所属 loop 线程时，会投递到 loop 的无锁队列里，由 loop 线程真正 write
     void send(std::string msg);
     // [新增] 按照协议发送 Header + MsgID + Data
-    void send(int msgid, std::string data);
+    // 包头和 Data 作为两个 iovec 用 writev 发出，不会把它们拼成新的 string
+    void send(int msgid, std::string_view data);
+    // 调用方不再需要 data 时用这个版本，跨线程投递也只移动不拷贝
+    void send(int msgid, std::string&& data);
+
+    // [新增] 在此之前提交的数据都交给内核之后，在所属 loop 线程中回调 cb (任意线程都可以调用)
+    // 用来按发送进度做流控：上一批真正发出去了再准备下一批；连接断开时 cb 不会被调用
+    void runAfterFlush(std::function<void()> cb);
 
     void setCloseCallback(const CloseCallback& cb) { closeCallback_ = cb; }
 
+    // [新增] 登录成功后记录这条连接属于哪个用户 (-1 表示未登录)，断开时据此直接定位，不用反查
+    void setUserId(int userid) { userId_.store(userid, std::memory_order_release); }
+    int getUserId() const { return userId_.load(std::memory_order_acquire); }
+
 private:
-    // 保护发送操作的互斥锁（因为多线程业务可能同时调用 send）
-    std::mutex sendMutex_;
+    // 真正的发送逻辑，只在所属 loop 线程中执行，所以不需要加锁
+    // 先把 header 和 data 一起 writev，写不完的部分追加到 writeBuffer_
+    void writeInLoop(const char* header, size_t headerLen, const char* data, size_t len);
+    // [新增] 发送遇到硬错误：丢弃积压数据和 flush 回调，关闭连接
+    void handleWriteError(int saveErrno);
 
-    // 发送缓冲区：当非阻塞 write 发生 EAGAIN/部分写时，剩余数据先入队
-    std::string writeBuffer_;
+    // 发送缓冲区：当非阻塞 write 发生 EAGAIN/部分写时，剩余数据先入队 (只在 loop 线程访问)
+    // 分块链式存储 + writev 发送，部分写只移动下标，不搬移积压数据
+    ChainBuffer writeBuffer_;
     bool writeEventEnabled_;
+    // [新增] 等发送缓冲区清空的回调 (只在 loop 线程访问)
+    std::vector<std::function<void()>> flushCallbacks_;
     std::atomic_bool closed_;
+    // [新增] 发送出过硬错误，之后的发送和 flush 回调一律丢弃 (只在 loop 线程访问)
+    bool disconnected_;
 
+    EventLoop* loop_;
     Epoll* epoll_;
     std::unique_ptr<Socket> socket_;
     Buffer readBuffer_;
-    
-    // [新增] 记录最后活跃时间戳
-    time_t lastActiveTime_;
+
+    // [新增] 所属用户 id (登录在业务线程写，断开时在其他线程读)
+    std::atomic<int> userId_;
 
     CloseCallback closeCallback_;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+// 基于 timerfd 的定时器队列
+// 所有定时器共用一个 timerfd，按到期时间放在最小堆里，timerfd 总是设成堆顶的到期时间，
+// 精度是纳秒级 (受内核调度影响，实际是亚毫秒级)
+// 非线程安全：只能在所属 EventLoop 线程中使用，跨线程请走 EventLoop::runAfter/runEvery/cancel
+class TimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerCallback = std::function<void()>;
+    using TimerId = uint64_t;
+
+    TimerQueue();
+    ~TimerQueue();
+
+    // timerfd，由 EventLoop 注册到自己的 Epoll 上
+    int fd() const { return timerFd_; }
+
+    // 添加定时器：when 到期后执行 cb；interval > 0 时之后每隔 interval 秒重复执行
+    void addTimer(TimerId id, Clock::time_point when, double interval, TimerCallback cb);
+    // 取消定时器 (已经执行过的一次性定时器、不存在的 id 都可以安全调用)
+    void cancel(TimerId id);
+
+    // timerfd 可读：执行所有到期的定时器
+    void handleRead();
+
+private:
+    struct Timer {
+        Clock::time_point when;
+        Clock::duration interval; // 0 表示只执行一次
+        TimerCallback cb;
+    };
+
+    // 堆里只存 (到期时间, id)，取消时只删 timers_，堆里的旧条目弹出时再跳过
+    struct HeapEntry {
+        Clock::time_point when;
+        TimerId id;
+        bool operator>(const HeapEntry& rhs) const { return when > rhs.when; }
+    };
+
+    // 堆顶条目是否已经失效 (被取消或者被重新调度过)
+    bool isStale(const HeapEntry& entry) const;
+    void pushHeap(Clock::time_point when, TimerId id);
+    // 弹掉堆顶的失效条目，再把 timerfd 设成最早的到期时间
+    void resetTimerfd();
+
+    int timerFd_;
+    std::vector<HeapEntry> heap_;
+    std::unordered_map<TimerId, Timer> timers_;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// 时间轮：用于空闲连接的超时踢出
+// 每个槽是一条侵入式双向链表，刷新活跃时间只是把节点挪到新槽 (O(1)，无内存分配)，
+// 每个 tick 只处理当前槽里的节点，代价是 O(到期数) 而不是 O(连接数)
+// 节点里记录了到期的 tick，超时时间超过一圈的节点会在槽里多留几圈，所以任意超时时间都能支持
+// 非线程安全：只能在所属 EventLoop 线程中使用
+class TimingWheel {
+public:
+    // 挂在时间轮上的对象需要继承这个钩子
+    class Entry {
+    public:
+        Entry() : wheel_(nullptr), prev_(nullptr), next_(nullptr), expireTick_(0) {}
+        virtual ~Entry();
+
+        // 到期时在 loop 线程中被调用 (调用前已经从时间轮上摘下)
+        virtual void onExpire() = 0;
+
+    private:
+        friend class TimingWheel;
+        TimingWheel* wheel_; // 当前挂在哪个时间轮上，nullptr 表示没挂
+        Entry* prev_;
+        Entry* next_;
+        uint64_t expireTick_;
+    };
+
+    // slots: 槽的个数；每个 tick 前进一格
+    explicit TimingWheel(size_t slots = 64);
+    ~TimingWheel();
+
+    // 设置超时的 tick 数，0 表示关闭超时检测 (之后 add 不再挂入新节点)
+    void setTimeout(uint64_t ticks) { timeoutTicks_ = ticks; }
+    uint64_t timeout() const { return timeoutTicks_; }
+
+    // 挂到 当前tick + timeout 的槽里
+    void add(Entry* entry);
+    // 活跃了一次：重新计算到期时间；只有落到新槽时才需要挪动节点
+    void refresh(Entry* entry);
+    // 从时间轮上摘下 (没挂着也可以调用)
+    void remove(Entry* entry);
+
+    // 前进一格，处理当前槽里所有到期的节点
+    void tick();
+
+private:
+    void link(Entry* entry);
+    void unlink(Entry* entry);
+
+    std::vector<Entry*> slots_; // 每个槽的链表头
+    uint64_t currentTick_;
+    uint64_t timeoutTicks_;
+    std::vector<Entry*> expired_; // tick 时暂存到期节点，复用内存
+};
@@ -15,4 +15,7 @@ enum EnMsgType {
 
     // [新增] 
     HEART_BEAT_MSG, // 心跳消息
+
+    // [新增] 消息类型个数，新的消息类型请加在它前面
+    MSG_TYPE_COUNT,
 };
\ No newline at end of file
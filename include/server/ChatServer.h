@@ -1,36 +1,62 @@
 #pragma once
-#include <map>
 #include <memory>
-#include <mutex> // [修复] 补全 mutex 头文件
-#include "net/Epoll.h"
+#include <vector>
+#include <string>
 #include "net/Socket.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadPool.h"
 #include "net/TcpConnection.h"
 
 class ChatServer {
 public:
     // 构造函数：指定监听端口
-    ChatServer(int port);
+    // ioThreadNum: Sub Reactor 线程数，0 表示单 Reactor (accept 和读写都在主线程)
+    // reusePort: 每个 IO 线程各自绑定一个 SO_REUSEPORT 监听 socket 并直接 accept，
+    //            连接不再经过主 Reactor 跨线程转交
+    ChatServer(int port, int ioThreadNum = 0, bool reusePort = false);
     ~ChatServer();
 
+    // [新增] reusePort 模式下把 IO 线程绑定到 CPU，并通过 SO_INCOMING_CPU 让内核
+    // 把在某个 CPU 上收到的新连接交给同一 CPU 上的监听 socket (需在 start 之前调用)
+    void setCpuAffinity(bool on) { cpuAffinity_ = on; }
+
+    // [新增] 空闲连接超时时间 (秒)，超过这么久没收到任何数据就断开，0 表示不检测 (需在 start 之前调用)
+    void setIdleTimeout(int seconds) { idleTimeout_ = seconds; }
+
+    // [新增] 业务线程数 (DB 通道)，0 表示按 CPU 核数自动决定 (需在 start 之前调用)
+    void setWorkerThreads(int dbThreads) { dbWorkers_ = dbThreads; }
+
+    // [新增] 本节点在集群里的 id (在线状态里记录用户在哪个节点)，默认是 主机名:端口 (需在 start 之前调用)
+    void setNodeId(const std::string& nodeId) { nodeId_ = nodeId; }
+
     // 启动服务
     void start();
 
 private:
-    // [新增] 定时检测连接活性的后台任务
-    void checkConnectionTask();
-
     // 处理新连接事件
-    void handleNewConnection();
+    // listener: 有新连接的监听 socket；acceptLoop: 执行 accept 的 loop
+    void handleNewConnection(Socket* listener, EventLoop* acceptLoop);
+
+    // [新增] 每个 IO 线程启动前的初始化：配置空闲超时，reusePort 模式下再注册监听 socket
+    void initIoLoop(EventLoop* loop, int index);
+    // [新增] reusePort 模式下，在每个 IO 线程启动前为其注册自己的监听 socket
+    void initShardLoop(EventLoop* loop, int index);
     // 处理客户端断开事件 (作为回调传给 TcpConnection)
-    void handleClientDisconnect(int fd);
+    void handleClientDisconnect(EventLoop* loop, int fd);
 
 private:
     int port_;
-    std::unique_ptr<Socket> listener_; // 监听 Socket
-    std::unique_ptr<Epoll> epoll_;     // Epoll 实例
-    
-    // 连接管理 Map：key是fd，value是连接对象
-    std::map<int, TcpConnection::ptr> connections_;
-    // [新增] 保护 connections_ 的互斥锁
-    std::mutex connMutex_;
+    bool reusePort_;
+    bool cpuAffinity_;
+    int idleTimeout_;
+    int dbWorkers_;
+    std::string nodeId_;
+    std::unique_ptr<Socket> listener_; // 监听 Socket (非 reusePort 模式)
+    // reusePort 模式下每个 IO 线程一个监听 Socket，下标对应 loop 序号
+    std::vector<std::unique_ptr<Socket>> shardListeners_;
+
+    // 主 Reactor：只负责监听 Socket 的 accept
+    std::unique_ptr<EventLoop> baseLoop_;
+    // Sub Reactor 线程池：每个线程一个 EventLoop，负责连接的读写
+    std::unique_ptr<EventLoopThreadPool> ioThreadPool_;
 };
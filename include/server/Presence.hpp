@@ -0,0 +1,107 @@
+#pragma once
+#include <hiredis/hiredis.h>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+
+// [新增] 在线状态 (presence)：记录每个在线用户在哪个节点上，代替 MySQL 里 User.state 字段
+//
+// Redis 里的数据：
+//   presence                 哈希表  userid -> 节点 id
+//   presence:users:<节点>    集合    该节点上的在线用户 (节点失效时据此清理)
+//   presence:node:<节点>     租约键  节点存活的证明，带过期时间，由 heartbeat 周期续约
+//   presence:nodes           集合    所有登记过的节点
+// 上下线时往 presence 通道发布变更，每个节点订阅该通道，在内存里维护一份完整的镜像，
+// 所以"某个用户在哪"是一次本地查表，不访问 Redis 也不访问数据库。
+// 节点崩溃后租约自然过期，其他节点的 heartbeat 发现后把它名下的用户清掉，不需要全表更新。
+// [修改] 续约在自己的线程和连接上进行，不占用事件循环，也不和登录争抢命令连接；
+// 订阅连接断开后自动重连，并重新加载在线表，镜像不会一直停留在断开时的状态。
+// [修改] 命令连接出错后自动重连；订阅恢复或续约发现租约曾经过期时，把本机在线用户重新写回 Redis。
+//
+// 没有连上 Redis 时退化为单机模式：只维护本机的镜像。
+class Presence {
+public:
+    Presence();
+    ~Presence();
+
+    // 连接 Redis，登记本节点 (nodeId 在集群内唯一) 并加载当前的在线表
+    // 同名节点之前遗留的在线记录 (例如崩溃后重启) 会先被清掉
+    // [修改] 成功后启动续约线程，每 kHeartbeatInterval 秒续约一次
+    bool start(const std::string& nodeId);
+
+    // 本机用户上线：记下 userid -> 本节点
+    // 该用户已经在另一个存活的节点上时返回 false (重复登录)
+    bool online(int userid);
+
+    // 本机用户下线 (只删除仍然指向本节点的记录，不会误删用户在别的节点上的新登录)
+    void offline(int userid);
+
+    // 用户所在的节点 id，不在线返回空串 (只查本地镜像)
+    std::string locate(int userid) const;
+
+    const std::string& nodeId() const { return nodeId_; }
+
+    // 租约时长和续约周期 (秒)：续约周期要明显小于租约，偶尔一次续约失败不至于被判定失效
+    static constexpr int kLeaseSeconds = 15;
+    static constexpr double kHeartbeatInterval = 5.0;
+    // [新增] 连接断开后重连的间隔 (秒)
+    static constexpr double kReconnectDelay = 1.0;
+
+private:
+    static constexpr size_t kShardCount = 64;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<int, std::string> nodes; // userid -> 节点 id
+    };
+
+    Shard& shardOf(int userid) { return shards_[static_cast<unsigned>(userid) % kShardCount]; }
+    const Shard& shardOf(int userid) const { return shards_[static_cast<unsigned>(userid) % kShardCount]; }
+
+    // 修改本地镜像
+    void mirrorSet(int userid, const std::string& node);
+    // 只有镜像里记的仍然是 node 时才删除
+    void mirrorErase(int userid, const std::string& node);
+
+    // 执行一条命令 (持有 cmdMutex_，连接断了先重连)，返回的 reply 由调用者释放
+    redisReply* command(const char* format, ...);
+    // [新增] 在续约连接上执行一条命令 (只有续约线程使用，启动时除外)，返回的 reply 由调用者释放
+    redisReply* heartbeatCommand(const char* format, ...);
+
+    // 续约本节点的租约，并清理租约已经过期的节点
+    void heartbeat();
+    // [新增] 续约线程：每 kHeartbeatInterval 秒调用一次 heartbeat，直到析构
+    void heartbeatLoop();
+    // 清理一个节点名下的所有在线记录 (在续约连接上执行)
+    void cleanupNode(const std::string& node);
+
+    // [新增] (重新) 建立订阅连接并订阅变更通道
+    bool subscribe();
+    // [新增] 把本机的在线用户重新写回 Redis (Redis 里的记录丢了之后恢复)
+    void restoreLocalUsers();
+    // [新增] 加载 Redis 里的在线表，修正本地镜像里其他节点的用户 (本节点的以本地为准)
+    void resync();
+    // 订阅线程：接收其他节点发布的上下线变更，连接断开后重连并重新同步
+    void observe();
+    // 处理一条变更："+<userid> <节点>" 或 "-<userid> <节点>"
+    void applyEvent(const char* event);
+
+    std::string nodeId_;
+    bool clustered_;             // [新增] start 成功后为 true；false 表示单机模式，不访问 Redis
+
+    std::mutex cmdMutex_;        // 命令连接会被多个业务线程和订阅线程 (重新同步时) 同时使用
+    redisContext* cmdContext_;
+    redisContext* subContext_;
+    redisContext* hbContext_;    // [新增] 续约专用的连接
+
+    // [新增] 续约线程
+    std::thread heartbeatThread_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCv_;
+    bool stop_;
+
+    Shard shards_[kShardCount];
+};
@@ -0,0 +1,86 @@
+#ifndef STRAND_H
+#define STRAND_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "net/MpscQueue.h"
+#include "server/ThreadPool.hpp"
+
+// [新增] 串行执行器 (strand)
+// 投递到同一个 Strand 的任务按投递顺序一个接一个执行 (同一时刻最多只有一个 worker 在跑它)，
+// 不同 Strand 之间仍然在线程池里并行。用来保证同一个连接的消息不会被乱序处理
+class Strand : public std::enable_shared_from_this<Strand> {
+public:
+    explicit Strand(ThreadPool& pool) : pool_(pool), pending_(0) {}
+
+    ~Strand() {
+        // 只有在没有排队任务时才会析构 (drain 持有 shared_ptr)，这里只是兜底
+        ThreadPool::Task* task;
+        while (queue_.pop(task)) {
+            delete task;
+        }
+    }
+
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    // 任意线程调用
+    template<class F>
+    void post(F&& f) {
+        queue_.push(ThreadPool::Task::create(std::forward<F>(f)));
+        // 计数从 0 变 1 的那个投递者负责把 strand 调度到线程池上
+        if (pending_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            schedule();
+        }
+    }
+
+private:
+    // 一次调度最多连续执行多少个任务，执行完还有剩余就重新排队，避免一个繁忙的 strand 霸占 worker
+    static constexpr int kMaxBatch = 32;
+
+    void schedule() {
+        pool_.post([self = shared_from_this()] { self->drain(); });
+    }
+
+    void drain() {
+        for (int i = 0; i < kMaxBatch; ++i) {
+            ThreadPool::Task* task;
+            // pending_ 说明一定有任务，pop 失败只可能是生产者还没挂上 next，稍等即可
+            while (!queue_.pop(task)) {
+                std::this_thread::yield();
+            }
+            ThreadPool::runTask(task);
+
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                return;
+            }
+        }
+        schedule();
+    }
+
+    ThreadPool& pool_;
+    MpscQueue<ThreadPool::Task*> queue_;
+    std::atomic<size_t> pending_;
+};
+
+// [新增] 按 key (连接 fd / 用户 id) 映射到固定数量的 Strand
+// 同一个 key 永远落在同一个 Strand 上，因此保序；不同 key 大概率落在不同 Strand 上并行执行
+class StrandGroup {
+public:
+    StrandGroup(ThreadPool& pool, size_t count) {
+        strands_.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            strands_.push_back(std::make_shared<Strand>(pool));
+        }
+    }
+
+    Strand& get(size_t key) { return *strands_[key % strands_.size()]; }
+
+private:
+    std::vector<std::shared_ptr<Strand>> strands_;
+};
+
+#endif
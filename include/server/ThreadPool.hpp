@@ -2,7 +2,7 @@
 #define THREADPOOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -10,37 +10,50 @@
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <iostream>
 
+#include "server/WorkStealingDeque.hpp"
+#include "server/MpmcQueue.hpp"
+
+// [修改] 工作窃取线程池
+// 每个 worker 有自己的 Chase-Lev 双端队列：worker 里 post 的任务压到自己的队列底部，
+// 空闲的 worker 从别人队列顶部窃取。非 worker 线程 (IO 线程) 提交的任务进入一个无锁的
+// 全局注入队列，任何 worker 都可以取。热路径上没有锁，只在 worker 要睡眠/唤醒时才碰互斥量
 class ThreadPool {
 public:
-    ThreadPool(size_t threads) : stop(false) {
-        for(size_t i = 0; i < threads; ++i)
-            workers.emplace_back(
-                [this] {
-                    for(;;) {
-                        std::function<void()> task;
-
-                        {
-                            std::unique_lock<std::mutex> lock(this->queue_mutex);
-                            this->condition.wait(lock,
-                                [this]{ return this->stop || !this->tasks.empty(); });
-                            
-                            if(this->stop && this->tasks.empty())
-                                return;
-                            
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                        }
-
-                        task();
-                    }
-                }
-            );
+    ThreadPool(size_t threads) : injector(kInjectorCapacity), overflowSize(0), sleepers(0), stop(false) {
+        for (size_t i = 0; i < threads; ++i)
+            queues.push_back(std::make_unique<WorkStealingDeque<Task*>>());
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    // [新增] 提交一个任务，不关心返回值 (不创建 future)
+    template<class F>
+    void post(F&& f) {
+        // don't allow enqueueing after stopping the pool
+        if (stop.load(std::memory_order_relaxed))
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+
+        Task* task = Task::create(std::forward<F>(f));
+        if (t_pool == this) {
+            // worker 自己产生的任务，压到自己的队列里，缓存更热
+            queues[t_index]->push(task);
+        } else if (!injector.push(task)) {
+            // 注入队列满了 (极少见)，退化到加锁的溢出队列
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            overflow.push_back(task);
+            overflowSize.fetch_add(1, std::memory_order_relaxed);
+        }
+        wakeOne();
     }
 
-    // 添加任务的接口
+    // 添加任务的接口 (需要拿到返回值时使用)
     template<class F, class... Args>
-    auto enqueue(F&& f, Args&&... args) 
+    auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::result_of<F(Args...)>::type>
     {
         using return_type = typename std::result_of<F(Args...)>::type;
@@ -48,38 +61,161 @@ public:
         auto task = std::make_shared<std::packaged_task<return_type()>>(
             std::bind(std::forward<F>(f), std::forward<Args>(args)...)
         );
-        
-        std::future<return_type> res = task->get_future();
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
 
-            tasks.emplace([task](){ (*task)(); });
-        }
-        condition.notify_one();
+        std::future<return_type> res = task->get_future();
+        post([task](){ (*task)(); });
         return res;
     }
 
     ~ThreadPool() {
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
+            std::unique_lock<std::mutex> lock(sleepMutex);
             stop = true;
         }
-        condition.notify_all();
-        for(std::thread &worker: workers)
+        sleepCv.notify_all();
+        for (std::thread &worker: workers)
             worker.join();
     }
 
+    // 小缓冲区优化的任务节点：捕获不超过 kInlineSize 的可调用对象直接放在节点里，
+    // 一个任务只有这一次堆分配 (std::function 捕获稍大一点就会再分配一次)
+    class Task {
+    public:
+        template<class F>
+        static Task* create(F&& f) {
+            using Fn = typename std::decay<F>::type;
+            Task* task = new Task;
+            if constexpr (sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t)) {
+                new (task->storage) Fn(std::forward<F>(f));
+                task->invoke = [](void* p) { (*static_cast<Fn*>(p))(); };
+                task->destroy = [](void* p) { static_cast<Fn*>(p)->~Fn(); };
+            } else {
+                // 放不下就退化为指针
+                new (task->storage) Fn*(new Fn(std::forward<F>(f)));
+                task->invoke = [](void* p) { (**static_cast<Fn**>(p))(); };
+                task->destroy = [](void* p) { delete *static_cast<Fn**>(p); };
+            }
+            return task;
+        }
+
+        ~Task() { destroy(storage); }
+        void run() { invoke(storage); }
+
+    private:
+        static constexpr size_t kInlineSize = 64;
+
+        Task() = default;
+
+        void (*invoke)(void*);
+        void (*destroy)(void*);
+        alignas(std::max_align_t) unsigned char storage[kInlineSize];
+    };
+
+    // 执行并释放一个任务 (Strand 也复用这里)
+    static void runTask(Task* task) {
+        // 没有 future 接异常了，不能让一个任务的异常把 worker 线程带走
+        try {
+            task->run();
+        } catch (const std::exception& e) {
+            std::cerr << "ThreadPool task exception: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "ThreadPool task unknown exception" << std::endl;
+        }
+        delete task;
+    }
+
 private:
+    static constexpr size_t kInjectorCapacity = 65536;
+    // 睡眠前再扫几轮，避免任务间隔很短时频繁睡眠/唤醒
+    static constexpr int kSpinRounds = 16;
+
+    void workerLoop(size_t index) {
+        t_pool = this;
+        t_index = index;
+
+        for (;;) {
+            Task* task = nullptr;
+            for (int i = 0; i < kSpinRounds && !task; ++i) {
+                task = findTask(index);
+                if (!task) std::this_thread::yield();
+            }
+
+            if (task) {
+                runTask(task);
+                continue;
+            }
+
+            // 没活干了，准备睡眠：先登记 sleepers 再复查一次，配合 wakeOne 避免丢失唤醒
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!stop && !hasWork())
+                sleepCv.wait(lock);
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+            if (stop && !hasWork())
+                return;
+        }
+    }
+
+    // 找任务的顺序：自己的队列 -> 全局注入队列 -> 溢出队列 -> 窃取其他 worker
+    Task* findTask(size_t index) {
+        Task* task = nullptr;
+        if (queues[index]->pop(task))
+            return task;
+        if (injector.pop(task))
+            return task;
+        if (overflowSize.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            if (!overflow.empty()) {
+                task = overflow.front();
+                overflow.pop_front();
+                overflowSize.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        const size_t n = queues.size();
+        for (size_t i = 1; i < n; ++i) {
+            if (queues[(index + i) % n]->steal(task))
+                return task;
+        }
+        return nullptr;
+    }
+
+    bool hasWork() const {
+        if (!injector.empty() || overflowSize.load(std::memory_order_relaxed) > 0)
+            return true;
+        for (const auto& q : queues) {
+            if (!q->empty())
+                return true;
+        }
+        return false;
+    }
+
+    void wakeOne() {
+        // 和 worker 登记 sleepers 之后的复查配对：要么它看到新任务，要么这里看到它在睡
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            sleepCv.notify_one();
+        }
+    }
+
+    inline static thread_local ThreadPool* t_pool = nullptr;
+    inline static thread_local size_t t_index = 0;
+
     std::vector<std::thread> workers;
-    std::queue< std::function<void()> > tasks;
-    
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop;
+    std::vector<std::unique_ptr<WorkStealingDeque<Task*>>> queues;
+
+    MpmcQueue<Task*> injector;
+    std::mutex overflowMutex;
+    std::deque<Task*> overflow;
+    std::atomic<size_t> overflowSize;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    std::atomic<int> sleepers;
+    std::atomic<bool> stop;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+#include <unordered_map>
+#include <shared_mutex>
+#include <memory>
+#include <atomic>
+#include "net/TcpConnection.h"
+
+// [新增] 在线用户 -> 连接 的注册表
+// 按 userid 分成若干分片，每片一把读写锁：不同用户的查找/登录/下线落在不同分片上互不干扰，
+// 同一分片内的查找 (转发消息时最频繁的操作) 也只拿读锁，可以并发
+class UserConnRegistry {
+public:
+    UserConnRegistry() : size_(0) {}
+
+    // 登记用户连接，该用户已经在本机有连接时返回 false
+    bool insert(int userid, const std::shared_ptr<TcpConnection>& conn);
+
+    // 查找用户连接，不在本机返回 nullptr
+    std::shared_ptr<TcpConnection> find(int userid) const;
+
+    // 移除用户连接：只有登记的仍然是 conn 时才删除 (防止误删同一用户后来的新连接)
+    bool erase(int userid, const TcpConnection* conn);
+
+    // 大致的在线人数
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kShardCount = 64;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<int, std::shared_ptr<TcpConnection>> conns;
+    };
+
+    Shard& shardOf(int userid) { return shards_[static_cast<unsigned>(userid) % kShardCount]; }
+    const Shard& shardOf(int userid) const { return shards_[static_cast<unsigned>(userid) % kShardCount]; }
+
+    Shard shards_[kShardCount];
+    std::atomic<size_t> size_;
+};
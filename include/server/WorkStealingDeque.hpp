@@ -0,0 +1,112 @@
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Chase-Lev 工作窃取双端队列 (Lê et al. 2013 的 C11 内存模型版本)
+// 只有所属 worker 可以在底部 push/pop (LIFO，缓存友好)，其他 worker 从顶部 steal (FIFO)
+// 元素类型 T 必须是可以放进 std::atomic 的小对象 (这里存放任务指针)
+template<typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int64_t capacity = 1024)
+        : top_(0), bottom_(0)
+    {
+        garbage_.push_back(std::make_unique<Array>(capacity));
+        array_.store(garbage_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // 只能由所属 worker 调用
+    void push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, b, t);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 只能由所属 worker 调用，空时返回 false
+    bool pop(T& item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // 已经空了
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = a->get(b);
+        if (t == b) {
+            // 只剩最后一个，和窃取者竞争
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // 任意线程调用，空或者竞争失败时返回 false
+    bool steal(T& item) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return false;
+        }
+
+        Array* a = array_.load(std::memory_order_acquire);
+        item = a->get(t);
+        return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // 近似判空 (只用于决定要不要睡眠)
+    bool empty() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    struct Array {
+        explicit Array(int64_t cap) : capacity(cap), mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T item) { slots[i & mask].store(item, std::memory_order_relaxed); }
+
+        int64_t capacity; // 必须是 2 的幂
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    // 扩容为两倍；旧数组可能还在被窃取者读取，所以不立即释放，留到队列析构时一起释放
+    Array* grow(Array* old, int64_t b, int64_t t) {
+        garbage_.push_back(std::make_unique<Array>(old->capacity * 2));
+        Array* a = garbage_.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            a->put(i, old->get(i));
+        }
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Array*> array_;
+    std::vector<std::unique_ptr<Array>> garbage_; // 只有所属 worker 会修改
+};
+
+#endif
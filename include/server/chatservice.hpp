@@ -1,9 +1,8 @@
 #pragma once
 
-#include <unordered_map>
 #include <functional>
-#include <mutex>
 #include <string>
+#include <string_view>
 #include <memory>
 
 #include "msg.pb.h"
@@ -11,12 +10,19 @@
 #include "server/model/offlinemessagemodel.hpp"
 #include "net/TcpConnection.h"
 #include "server/ThreadPool.hpp"
+#include "server/Strand.hpp"
+#include "server/UserConnRegistry.hpp"
+#include "server/Presence.hpp"
 #include "db/Redis.h"
 
-// 业务回调函数类型
-// conn: 连接对象 (用于回发数据)
-// data: 序列化后的 protobuf 数据字符串 (去掉 header 和 msgid 后的纯数据)
-using MsgHandler = std::function<void(const std::shared_ptr<TcpConnection>& conn, std::string& data)>;
+// [新增] 业务执行通道
+// INLINE: 直接在 IO 线程上执行，不跨线程、不拷贝数据，只适合不会阻塞的轻量处理 (心跳、在线转发)
+// DB    : 会阻塞在 MySQL 上的操作 (登录、注册、离线消息)，单独一组线程，慢查询不会拖住在线聊天
+// [修改] 去掉了 CPU 通道：纯内存的处理都改成了 INLINE，没有处理器再用它，只剩一组空转的线程
+enum class Lane {
+    INLINE,
+    DB,
+};
 
 
 // 聊天服务器业务类 (单例模式)
@@ -26,16 +32,16 @@ public:
     static ChatService* instance();
 
     // 处理登录业务
-    void login(const std::shared_ptr<TcpConnection>& conn, std::string& data);
+    void login(const std::shared_ptr<TcpConnection>& conn, std::string_view data);
 
     // 处理注册业务
-    void reg(const std::shared_ptr<TcpConnection>& conn, std::string& data);
+    void reg(const std::shared_ptr<TcpConnection>& conn, std::string_view data);
 
     // 处理一对一聊天业务
-    void oneChat(const std::shared_ptr<TcpConnection>& conn, std::string& data);
+    void oneChat(const std::shared_ptr<TcpConnection>& conn, std::string_view data);
 
     // [新增] 处理心跳业务
-    void clientHeartBeat(const std::shared_ptr<TcpConnection>& conn, std::string& data);
+    void clientHeartBeat(const std::shared_ptr<TcpConnection>& conn, std::string_view data);
 
     // 处理客户端异常退出
     void clientCloseException(const std::shared_ptr<TcpConnection>& conn);
@@ -43,17 +49,49 @@ public:
     // 从 Redis 消息队列中获取订阅的消息
     void handleRedisSubscribeMessage(int userid, std::string msg);
 
-    // 获取消息对应的处理器
-    MsgHandler getHandler(int msgid);
+    // [新增] 发布到别的节点的消息没有订阅者收到 (由 Redis 的发送线程调用)
+    void handleRedisUndelivered(int userid, std::string msg);
+
+    // [修改] 按消息 id 分发给对应的处理器 (IO 线程调用)
+    // 查表只是一次数组下标，不分配、不哈希；按处理器声明的通道就地执行或投递到工作线程
+    // conn: 连接对象 (用于回发数据)
+    // data: 序列化后的 protobuf 数据 (去掉 header 和 msgid 后的纯数据)
+    //       只是一段视图，只保证在本次调用期间有效，需要保存时请自行拷贝
+    void dispatch(int msgid, const std::shared_ptr<TcpConnection>& conn, std::string_view data);
+
+    // [新增] 处理器描述 (消息 id 到描述的映射是一张编译期生成的定长表，见 chatservice.cpp)
+    struct HandlerDesc {
+        void (ChatService::*method)(const std::shared_ptr<TcpConnection>& conn, std::string_view data);
+        Lane lane;
+    };
+
+    // [新增] 创建 DB 通道的工作线程，传 0 表示按 CPU 核数自动决定 (需在收到消息前调用)
+    void startWorkers(size_t dbThreads);
+
+    // [新增] 以 nodeId 登记本节点并开始维护在线状态 (需在收到消息前调用)
+    void startPresence(const std::string& nodeId);
+
+    // [新增] 打印运行统计 (用户缓存命中率)，由服务器的定时器周期调用
+    void logStats();
+
+    // [新增] 把一个会阻塞的任务交给 DB 通道的线程执行 (不经过 strand，不保序)，任意线程可调用
+    // 事件循环上的定时任务要关数据库连接之类时用它，不让 IO 线程卡在网络往返上
+    void runOnDbLane(std::function<void()> task);
 
 private:
     ChatService();
 
-    // 存储消息id和其对应的业务处理方法
-    std::unordered_map<int, MsgHandler> _msgHandlerMap;
+    // [新增] 对方不在本机时的后半段：查库决定发布到 Redis 还是存离线 (在 DB 通道执行)
+    void forwardOrStore(int toid, std::string data);
+
+    // [新增] 推送 afterId 之后的一页离线消息，发完后接着推下一页 (在 DB 通道执行)
+    void deliverOffline(const std::shared_ptr<TcpConnection>& conn, int userid, long long afterId);
 
-    // 线程池
-    std::unique_ptr<ThreadPool> _threadPool;
+    // [修改] 阻塞操作专用的线程池 (DB 通道)
+    std::unique_ptr<ThreadPool> _dbPool;
+
+    // [新增] 按连接分配的串行执行器，保证同一连接、同一通道内的消息按到达顺序处理
+    std::unique_ptr<StrandGroup> _dbStrands;
 
     // Redis 对象
     Redis _redis;
@@ -63,6 +101,9 @@ private:
     OfflineMsgModel _offlineMsgModel;
 
     // 存储在线用户的通信连接
-    std::mutex _connMutex;
-    std::unordered_map<int, std::shared_ptr<TcpConnection>> _userConnMap;
+    // [修改] 分片注册表，替代原来一把大锁保护的 map
+    UserConnRegistry _userConns;
+
+    // [新增] 在线状态：用户 -> 所在节点 (代替 User.state)
+    Presence _presence;
 };
\ No newline at end of file
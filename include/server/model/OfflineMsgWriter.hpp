@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+// [新增] 离线消息批量写入器
+// 各个业务线程提交的离线消息先攒在内存里，由后台线程按条数或时间窗口合并成多行
+// INSERT ... VALUES (?, ?), (?, ?) ... 一次提交，代替每条消息一次连接借还 + 一次自动提交。
+// 所有批次按提交顺序在同一条异步连接上执行。
+// [修改] 失败按原因处理：
+//   连接断了：这条连接上后面的批次也都会失败，等它们都有了结果，换一条连接、隔一会儿排在新消息前面
+//             重新提交，直到成功，同一用户的消息不会乱序；
+//   语句出错 (某一行数据有问题)：整批拆成单行重新执行，只有出错的那一行以 ok=false 确认并丢弃，
+//             不让一行坏数据卡住后面所有的消息。拆开重做的行可能排到出错之后提交的消息后面。
+class OfflineMsgWriter {
+public:
+    // 落库结果通知 (在数据库 IO 线程里调用，不要做阻塞操作)
+    // 连接断开会一直重试；单行执行仍然出错的消息、析构时还没写进去的消息以 ok=false 通知
+    using AckCallback = std::function<void(bool ok)>;
+
+    OfflineMsgWriter();
+    // 停止后台线程，剩下的消息提交之后再返回
+    ~OfflineMsgWriter();
+
+    OfflineMsgWriter(const OfflineMsgWriter&) = delete;
+    OfflineMsgWriter& operator=(const OfflineMsgWriter&) = delete;
+
+    // 提交一条离线消息；未确认的消息太多时阻塞调用者，直到有批次落库 (背压)
+    void append(int userid, std::string msg, AckCallback ack = nullptr);
+
+    // [修改] 立即提交攒着的消息，并等待调用之前提交给 userid 的消息全部落库 (读该用户的离线消息之前调用)
+    // 只等这一个用户的，别的用户积压再多也不影响
+    void drain(int userid);
+
+private:
+    struct Row {
+        int userid;
+        std::string msg;
+        AckCallback ack;
+        bool single = false; // [新增] 所在批次执行出错过，要单独一行执行以找出坏行
+    };
+
+    // 后台线程：等够一批或者时间窗口到了就提交
+    void run();
+    // 把一批消息拆成预编译好的几档多行 INSERT，按顺序提交到 orderKey 对应的异步连接
+    void submit(std::vector<Row> rows, int orderKey);
+    // 一条多行 INSERT 执行完：成功就确认；连接断了整批放进 retry_，语句出错拆成单行放进 retry_；
+    // 单行也出错就以失败确认
+    void onBatchDone(std::vector<Row>& rows, bool ok, bool connLost);
+
+    static constexpr size_t kMaxBatch = 64;      // 攒够这么多条立即提交
+    static constexpr int kFlushWindowMs = 5;      // 第一条消息最多等这么久
+    static constexpr size_t kMaxPending = 8192;   // 未确认消息的上限，超过后 append 阻塞
+    static constexpr int kDrainTimeoutMs = 3000;  // drain 最多等这么久 (数据库卡住时不让登录一直挂着)
+    static constexpr int kRetryDelayMs = 1000;    // 失败的批次隔这么久再重试 (和异步连接的重连间隔一致)
+
+    std::mutex mutex_;
+    std::condition_variable wakeCv_; // 唤醒后台线程
+    std::condition_variable doneCv_; // 有批次落库 (背压和 drain 在这上面等)
+    std::vector<Row> rows_;          // 还没提交的消息
+    std::vector<Row> retry_;         // [新增] 执行失败、等待重试的消息 (按原来的提交顺序)
+    bool connLost_;                  // [新增] retry_ 里有因为连接断开失败的批次，重试前换连接并等待
+    int orderKey_;                   // [新增] 当前使用的顺序键 (只有后台线程读写)，连接断开后换下一条
+    std::chrono::steady_clock::time_point firstAt_; // rows_ 里第一条消息的提交时间
+    size_t pending_;                 // 已 append 但还没确认的条数
+    size_t inflight_;                // [新增] 已交给异步连接、还没有结果的批次数
+    std::unordered_map<int, size_t> unacked_; // [新增] 每个用户还没确认的条数 (drain 按用户等待)
+    bool flushNow_;
+    bool stop_;
+    std::thread thread_;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include "db/Statement.h"
+
+// [新增] 所有预编译语句统一在这里登记
+// 每条连接按 id 缓存 prepare 好的 MYSQL_STMT，所以 id 和 SQL 必须一一对应，新增语句时在枚举末尾加 id
+enum SqlStmtId {
+    STMT_USER_INSERT,
+    STMT_USER_QUERY,
+    STMT_OFFLINE_INSERT,
+    STMT_OFFLINE_QUERY,
+    STMT_OFFLINE_REMOVE,
+    STMT_OFFLINE_INSERT_4,  // [新增] 多行插入，SQL 由 OfflineMsgWriter 按行数生成
+    STMT_OFFLINE_INSERT_16,
+    STMT_OFFLINE_INSERT_64,
+};
+
+// User 表
+inline constexpr StmtDef kUserInsert{STMT_USER_INSERT, "INSERT INTO User(name, password, state) VALUES(?, ?, ?)"};
+inline constexpr StmtDef kUserQuery{STMT_USER_QUERY, "SELECT id, name, password, state FROM User WHERE id = ?"};
+
+// OfflineMessage 表
+inline constexpr StmtDef kOfflineInsert{STMT_OFFLINE_INSERT, "INSERT INTO OfflineMessage(userid, message) VALUES(?, ?)"};
+// [修改] 按消息 id 分页读取 (keyset 分页，走 (userid, id) 索引，不用 OFFSET)，删除也只删到已发出的 id
+inline constexpr StmtDef kOfflineQuery{STMT_OFFLINE_QUERY,
+    "SELECT id, message FROM OfflineMessage WHERE userid = ? AND id > ? ORDER BY id LIMIT ?"};
+inline constexpr StmtDef kOfflineRemove{STMT_OFFLINE_REMOVE, "DELETE FROM OfflineMessage WHERE userid = ? AND id <= ?"};
@@ -0,0 +1,57 @@
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "server/model/User.hpp"
+
+// [新增] 进程内的 User 记录缓存 (UserModel::query 的读穿透缓存)
+// 按 userid 分片，每片一把锁 + 一条 LRU 链表；条目过了 TTL 就当作未命中，重新查库。
+// 别的服务器对记录的修改最多延迟一个 TTL 才能看到。
+class UserCache {
+public:
+    // capacityPerShard: 每个分片最多缓存的用户数；ttl: 一条记录从查库起的有效期
+    explicit UserCache(size_t capacityPerShard = 1024,
+                       std::chrono::milliseconds ttl = std::chrono::milliseconds(5000));
+
+    // 命中且没过期时把记录写到 user 里并返回 true
+    bool get(int userid, User& user);
+
+    // 放入 (或覆盖) 一条刚从数据库读到的记录
+    void put(User user);
+
+    // 删除一条记录，下次查询时重新查库
+    void invalidate(int userid);
+
+    // 命中/未命中次数 (过期也算未命中)
+    unsigned long long hits() const { return hits_.load(std::memory_order_relaxed); }
+    unsigned long long misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        int userid;
+        User user;
+        Clock::time_point expireAt;
+    };
+
+    static constexpr size_t kShardCount = 64;
+
+    // 链表头是最近使用的，满了从链表尾淘汰
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;
+        std::unordered_map<int, std::list<Entry>::iterator> index;
+    };
+
+    Shard& shardOf(int userid) { return shards_[static_cast<unsigned>(userid) % kShardCount]; }
+
+    const size_t capacityPerShard_;
+    const std::chrono::milliseconds ttl_;
+    Shard shards_[kShardCount];
+    std::atomic<unsigned long long> hits_;
+    std::atomic<unsigned long long> misses_;
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "server/model/User.hpp"
+#include "server/model/UserCache.hpp"
 
 class UserModel {
 public:
@@ -7,11 +8,15 @@ public:
     bool insert(User& user);
 
     // 根据用户ID查询用户信息（登录验证）
+    // [修改] 先查进程内缓存，未命中或过期才查库
     User query(int id);
 
-    // 更新用户的状态信息
-    bool updateState(User user);
+    // [修改] 在线状态改由 Presence 维护 (见 server/Presence.hpp)，不再写 User.state，
+    // 原来的 updateState / resetState 已删除
 
-    // 重置所有用户的状态信息（服务器重启时使用）
-    void resetState();
+    // [新增] 用户缓存 (命中率统计等)
+    const UserCache& cache() const { return _cache; }
+
+private:
+    UserCache _cache;
 };
\ No newline at end of file
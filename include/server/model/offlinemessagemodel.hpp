@@ -1,15 +1,34 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "server/model/OfflineMsgWriter.hpp"
+
+// [新增] 一条离线消息 (id 是表里的自增主键，用作分页游标)
+struct OfflineMsg {
+    long long id;
+    std::string msg;
+};
 
 class OfflineMsgModel {
 public:
     // 存储用户的离线消息
-    void insert(int userid, std::string msg);
+    // [修改] 交给批量写入器合并提交，立即返回 (积压太多时会阻塞，只应在 DB 通道调用)
+    // ack 非空时在消息真正落库 (或失败) 后回调
+    void insert(int userid, std::string msg, OfflineMsgWriter::AckCallback ack = nullptr);
 
     // 删除用户的离线消息
-    void remove(int userid);
+    // [修改] 只删除 id <= upToId 的 (已经发出去的)，之后新存的不受影响；异步执行，立即返回
+    void remove(int userid, long long upToId);
 
     // 查询用户的离线消息
-    std::vector<std::string> query(int userid);
+    // [修改] 按 id 分页：返回 id > afterId 的最多 limit 条，按 id 升序
+    // 先等写入器里攒着的这个用户的消息落库，刚存下的离线消息不会漏读
+    std::vector<OfflineMsg> query(int userid, long long afterId, size_t limit);
+
+    // [新增] 旧表结构的迁移 (服务器启动时调用一次，已经迁移过则什么都不做)
+    // message 从 Hex 文本改成 BLOB；补上自增 id 列和 (userid, id) 索引
+    void migrate();
+
+private:
+    OfflineMsgWriter _writer;
 };
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "db/AsyncConnection.h"
+#include <mysql/errmsg.h>
+#include <iostream>
+
+// [新增] 这些错误码说明连接本身已经不可用，而不是这一条语句有问题
+static bool isConnectionLost(unsigned int err) {
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST
+        || err == CR_CONNECTION_ERROR || err == CR_CONN_HOST_ERROR;
+}
+
+AsyncConnection::AsyncConnection(EventLoop* loop)
+    : loop_(loop),
+      conn_(std::make_unique<Connection>()),
+      port_(0),
+      fd_(-1),
+      registered_(false),
+      events_(0),
+      broken_(false),
+      state_(State::Idle),
+      stmt_(nullptr),
+      error_(0),
+      timer_(0)
+{
+}
+
+AsyncConnection::~AsyncConnection() {
+    if (registered_) {
+        loop_->getEpoll()->updateChannel(fd_, EPOLL_CTL_DEL, 0, nullptr);
+    }
+}
+
+bool AsyncConnection::connect(const std::string& ip, unsigned short port, const std::string& user,
+                              const std::string& password, const std::string& dbname) {
+    ip_ = ip;
+    port_ = port;
+    user_ = user;
+    password_ = password;
+    dbname_ = dbname;
+
+    conn_->setNonBlocking();
+    if (!conn_->connect(ip_, port_, user_, password_, dbname_)) {
+        broken_ = true;
+        loop_->runAfter(kReconnectDelay, [this]() { reconnect(); });
+        return false;
+    }
+    fd_ = mysql_get_socket(conn_->getHandle());
+    return true;
+}
+
+// [新增] 重连：换一个全新的句柄，成功后接着处理重连期间提交的请求
+void AsyncConnection::reconnect() {
+    auto conn = std::make_unique<Connection>();
+    conn->setNonBlocking();
+    if (!conn->connect(ip_, port_, user_, password_, dbname_)) {
+        loop_->runAfter(kReconnectDelay, [this]() { reconnect(); });
+        return;
+    }
+
+    conn_ = std::move(conn);
+    fd_ = mysql_get_socket(conn_->getHandle());
+    registered_ = false;
+    events_ = 0;
+    broken_ = false;
+    std::cout << "异步数据库连接已重连 fd=" << fd_ << std::endl;
+    startNext();
+}
+
+void AsyncConnection::execute(Request req) {
+    if (broken_) {
+        current_ = std::move(req);
+        complete(false, true);
+        return;
+    }
+    pending_.push_back(std::move(req));
+    startNext();
+}
+
+void AsyncConnection::startNext() {
+    // 回调里可能又提交了新请求并已经开始执行，所以每轮都要重新检查状态
+    while (state_ == State::Idle && !pending_.empty() && !broken_) {
+        current_ = std::move(pending_.front());
+        pending_.pop_front();
+        state_ = State::Querying;
+
+        // [新增] 每条语句在本连接上只在第一次用到时 prepare (阻塞一次往返)，之后直接执行
+        stmt_ = conn_->prepare(*current_.stmt);
+        if (stmt_ == nullptr || !current_.params.bind(stmt_)) {
+            unsigned int err = mysql_errno(conn_->getHandle());
+            fail(err);
+            continue;
+        }
+
+#ifdef DB_HAS_NONBLOCK_API
+        advance(mysql_stmt_execute_start(&error_, stmt_));
+#else
+        // 没有非阻塞接口：退化为在本线程里阻塞执行，对调用者来说仍然是异步回调
+        error_ = mysql_stmt_execute(stmt_);
+        advance(0);
+#endif
+    }
+
+    // 没活了就不再关注读写事件，免得空闲连接被无谓唤醒
+    if (state_ == State::Idle && registered_) {
+        setEvents(0);
+    }
+}
+
+void AsyncConnection::advance(int status) {
+#ifdef DB_HAS_NONBLOCK_API
+    if (status != 0) {
+        // 库需要等 socket 可读/可写或者超时，挂到 Epoll 上等着
+        uint32_t events = 0;
+        if (status & MYSQL_WAIT_READ) events |= EPOLLIN;
+        if (status & MYSQL_WAIT_WRITE) events |= EPOLLOUT;
+        if (status & MYSQL_WAIT_EXCEPT) events |= EPOLLPRI;
+        setEvents(events);
+        if (status & MYSQL_WAIT_TIMEOUT) {
+            double timeout = mysql_get_timeout_value(conn_->getHandle());
+            timer_ = loop_->runAfter(timeout, [this]() {
+                timer_ = 0;
+                resume(MYSQL_WAIT_TIMEOUT);
+            });
+        }
+        return;
+    }
+#else
+    (void)status; // 阻塞执行，调用时已经完成
+#endif
+
+    if (error_ != 0) {
+        std::cout << "异步执行失败: " << current_.stmt->sql << std::endl;
+        std::cout << mysql_stmt_error(stmt_) << std::endl;
+        fail(mysql_stmt_errno(stmt_));
+        return;
+    }
+    complete(true);
+}
+
+void AsyncConnection::resume(int ready) {
+#ifdef DB_HAS_NONBLOCK_API
+    if (timer_ != 0) {
+        loop_->cancel(timer_);
+        timer_ = 0;
+    }
+    advance(mysql_stmt_execute_cont(&error_, stmt_, ready));
+    startNext();
+#else
+    (void)ready;
+#endif
+}
+
+void AsyncConnection::handleEvent(uint32_t revents) {
+    if (state_ == State::Idle) {
+        // 空闲时只会收到错误/挂断：服务器把连接关了
+        if (revents & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            markBroken();
+        }
+        return;
+    }
+
+#ifdef DB_HAS_NONBLOCK_API
+    int ready = 0;
+    if (revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) ready |= MYSQL_WAIT_READ;
+    if (revents & EPOLLOUT) ready |= MYSQL_WAIT_WRITE;
+    if (revents & EPOLLPRI) ready |= MYSQL_WAIT_EXCEPT;
+    resume(ready);
+#endif
+}
+
+void AsyncConnection::complete(bool ok, bool connLost) {
+    Request req = std::move(current_);
+    MYSQL_STMT* stmt = stmt_;
+    current_ = Request();
+    state_ = State::Idle;
+    stmt_ = nullptr;
+
+    // 回调里可能提交新请求，insert id 要在回调之前取
+    if (req.onUpdate) {
+        unsigned long long insertId = (ok && stmt != nullptr) ? mysql_stmt_insert_id(stmt) : 0;
+        req.onUpdate(ok, insertId, connLost);
+    }
+}
+
+void AsyncConnection::setEvents(uint32_t events) {
+    if (fd_ < 0 || (registered_ && events == events_)) {
+        return;
+    }
+    loop_->getEpoll()->updateChannel(fd_, registered_ ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, events, this);
+    registered_ = true;
+    events_ = events;
+}
+
+void AsyncConnection::markBroken() {
+    if (broken_) {
+        return;
+    }
+    std::cout << "异步数据库连接已断开 fd=" << fd_ << "，" << kReconnectDelay << " 秒后重连" << std::endl;
+    broken_ = true;
+    if (timer_ != 0) {
+        loop_->cancel(timer_);
+        timer_ = 0;
+    }
+    if (registered_) {
+        loop_->getEpoll()->updateChannel(fd_, EPOLL_CTL_DEL, 0, nullptr);
+        registered_ = false;
+    }
+    // 先置 broken_ 再回调：回调里新提交的请求直接失败，不会落到已经断开的连接上
+    if (state_ != State::Idle) {
+        complete(false, true);
+    }
+    while (!pending_.empty()) {
+        current_ = std::move(pending_.front());
+        pending_.pop_front();
+        complete(false, true);
+    }
+    loop_->runAfter(kReconnectDelay, [this]() { reconnect(); });
+}
+
+void AsyncConnection::fail(unsigned int err) {
+    if (isConnectionLost(err)) {
+        markBroken();
+    } else {
+        complete(false);
+    }
+}
@@ -1,5 +1,6 @@
 #include "db/Connection.h"
 #include <iostream>
+#include <cstring>
 
 Connection::Connection() {
     // 初始化数据库句柄
@@ -7,6 +8,13 @@ Connection::Connection() {
 }
 
 Connection::~Connection() {
+    // [新增] 先关闭预编译语句，再关闭连接
+    for (MYSQL_STMT* stmt : stmts_) {
+        if (stmt != nullptr) {
+            mysql_stmt_close(stmt);
+        }
+    }
+
     // 释放数据库连接资源
     if (conn_ != nullptr) {
         mysql_close(conn_);
@@ -27,6 +35,12 @@ bool Connection::connect(std::string ip, unsigned short port, std::string user,
     return p != nullptr;
 }
 
+void Connection::setNonBlocking() {
+#ifdef DB_HAS_NONBLOCK_API
+    mysql_options(conn_, MYSQL_OPT_NONBLOCK, 0);
+#endif
+}
+
 bool Connection::update(std::string sql) {
     // mysql_query 返回 0 表示成功
     if (mysql_query(conn_, sql.c_str())) {
@@ -45,4 +59,65 @@ MYSQL_RES* Connection::query(std::string sql) {
         return nullptr;
     }
     return mysql_use_result(conn_);
-}
\ No newline at end of file
+}
+
+MYSQL_STMT* Connection::prepare(const StmtDef& def) {
+    if (def.id < 0) {
+        return nullptr;
+    }
+    if (static_cast<size_t>(def.id) >= stmts_.size()) {
+        stmts_.resize(def.id + 1, nullptr);
+    }
+    if (stmts_[def.id] != nullptr) {
+        return stmts_[def.id];
+    }
+
+    MYSQL_STMT* stmt = mysql_stmt_init(conn_);
+    if (stmt == nullptr) {
+        std::cout << "创建预编译语句失败: " << mysql_error(conn_) << std::endl;
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, def.sql, strlen(def.sql))) {
+        std::cout << "预编译失败: " << def.sql << std::endl;
+        std::cout << mysql_stmt_error(stmt) << std::endl;
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    stmts_[def.id] = stmt;
+    return stmt;
+}
+
+MYSQL_STMT* Connection::run(const StmtDef& def, StmtParams& params) {
+    MYSQL_STMT* stmt = prepare(def);
+    if (stmt == nullptr || !params.bind(stmt)) {
+        return nullptr;
+    }
+    if (mysql_stmt_execute(stmt)) {
+        std::cout << "执行失败: " << def.sql << std::endl;
+        std::cout << mysql_stmt_error(stmt) << std::endl;
+        return nullptr;
+    }
+    return stmt;
+}
+
+bool Connection::execute(const StmtDef& def, StmtParams& params, unsigned long long* insertId) {
+    MYSQL_STMT* stmt = run(def, params);
+    if (stmt == nullptr) {
+        return false;
+    }
+    if (insertId != nullptr) {
+        *insertId = mysql_stmt_insert_id(stmt);
+    }
+    return true;
+}
+
+StmtReader Connection::query(const StmtDef& def, StmtParams& params) {
+    MYSQL_STMT* stmt = run(def, params);
+    // 把结果整个取到客户端，读取期间连接上还可以执行别的语句
+    if (stmt != nullptr && mysql_stmt_store_result(stmt)) {
+        std::cout << "获取结果失败: " << mysql_stmt_error(stmt) << std::endl;
+        mysql_stmt_free_result(stmt);
+        stmt = nullptr;
+    }
+    return StmtReader(stmt);
+}
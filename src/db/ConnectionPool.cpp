@@ -9,7 +9,15 @@ ConnectionPool* ConnectionPool::getInstance() {
 }
 
 // 构造函数：解析配置、创建初始连接、启动维护线程
-ConnectionPool::ConnectionPool() {
+ConnectionPool::ConnectionPool()
+    : port_(0),
+      initSize_(0),
+      maxSize_(0),
+      maxIdleTime_(0),
+      connectionTimeout_(0),
+      asyncSize_(0),
+      connectionCnt_(0)
+{
     // 1. 加载配置
     if (!loadConfigFile()) {
         return;
@@ -29,9 +37,70 @@ ConnectionPool::ConnectionPool() {
     std::thread produce(std::bind(&ConnectionPool::produceConnectionTask, this));
     produce.detach(); // 分离线程，让它自己在后台跑
 
-    // 4. 启动一个新的线程，作为扫描者（回收超时空闲连接）
-    std::thread scanner(std::bind(&ConnectionPool::scannerConnectionTask, this));
-    scanner.detach();
+    // 4. 回收超时空闲连接的扫描由外部定时器周期调用 scanIdleConnections()
+
+    // 5. [新增] 异步连接和数据库 IO 线程
+    if (asyncSize_ > 0) {
+        startAsync();
+    }
+}
+
+// [新增] 创建异步连接并启动数据库 IO 线程
+void ConnectionPool::startAsync() {
+    asyncLoop_ = std::make_unique<EventLoop>();
+    for (int i = 0; i < asyncSize_; ++i) {
+        auto conn = std::make_unique<AsyncConnection>(asyncLoop_.get());
+        // [修改] 连不上的也留着，它会在 loop 上自己定时重连
+        conn->connect(ip_, port_, username_, password_, dbname_);
+        asyncConns_.push_back(std::move(conn));
+    }
+
+    EventLoop* loop = asyncLoop_.get();
+    std::thread t([loop]() { loop->loop(); });
+    t.detach();
+
+    std::cout << "异步数据库连接数: " << asyncConns_.size() << std::endl;
+}
+
+AsyncConnection* ConnectionPool::pickAsyncConnection(int orderKey) {
+    if (orderKey >= 0) {
+        // [修改] 不顺延到别的连接：断开期间后提交的请求如果在别的连接上先成功，就和前面失败的请求乱序了。
+        // 断开的连接会让请求以 connLost 失败，由调用者决定重试还是换一个顺序键
+        return asyncConns_[orderKey % asyncConns_.size()].get();
+    }
+    AsyncConnection* best = nullptr;
+    for (auto& conn : asyncConns_) {
+        if (conn->isBroken()) {
+            continue;
+        }
+        if (best == nullptr || conn->pendingCount() < best->pendingCount()) {
+            best = conn.get();
+        }
+    }
+    // 全都断了就随便交给一条，由它以失败结束请求
+    return best != nullptr ? best : asyncConns_.front().get();
+}
+
+void ConnectionPool::asyncExecute(const StmtDef& def, StmtParams params,
+                                  AsyncConnection::UpdateCallback cb, int orderKey) {
+    if (asyncConns_.empty()) {
+        // 没有异步连接，同步执行
+        std::shared_ptr<Connection> sp = getConnection();
+        unsigned long long insertId = 0;
+        bool ok = sp && sp->execute(def, params, &insertId);
+        if (cb) {
+            cb(ok, insertId, !sp); // 借不到连接按连接断开处理
+        }
+        return;
+    }
+
+    AsyncConnection::Request req;
+    req.onUpdate = std::move(cb);
+    req.stmt = &def;
+    req.params = std::move(params);
+    asyncLoop_->runInLoop([this, orderKey, req = std::move(req)]() mutable {
+        pickAsyncConnection(orderKey)->execute(std::move(req));
+    });
 }
 
 // 解析配置文件 (简单粗暴的字符串解析)
@@ -67,6 +136,7 @@ bool ConnectionPool::loadConfigFile() {
         else if (key == "maxSize") maxSize_ = atoi(value.c_str());
         else if (key == "maxIdleTime") maxIdleTime_ = atoi(value.c_str());
         else if (key == "connectionTimeout") connectionTimeout_ = atoi(value.c_str());
+        else if (key == "asyncSize") asyncSize_ = atoi(value.c_str());
     }
     return true;
 }
@@ -130,23 +200,25 @@ std::shared_ptr<Connection> ConnectionPool::getConnection() {
     return sp;
 }
 
-// 扫描线程：定期检查并销毁长时间不用的连接
-void ConnectionPool::scannerConnectionTask() {
-    while (true) {
-        // 模拟定时轮询
-        std::this_thread::sleep_for(std::chrono::seconds(maxIdleTime_));
-
+// 定期检查并销毁长时间不用的连接 (每 maxIdleTime 秒在 DB 通道的线程上调用一次)
+void ConnectionPool::scanIdleConnections() {
+    std::vector<Connection*> expired;
+    {
         std::unique_lock<std::mutex> lock(queueMutex_);
-        while (connectionCnt_ > initSize_) {
+        while (connectionCnt_ > initSize_ && !connectionQueue_.empty()) {
             Connection* p = connectionQueue_.front();
             // 如果队头的连接空闲时间超过了设定值，就把它销毁
             if (p->getAliveTime() >= (maxIdleTime_ * 1000)) {
                 connectionQueue_.pop();
                 connectionCnt_--;
-                delete p; // 真正的销毁物理连接
+                expired.push_back(p);
             } else {
                 break; // 队头都没超时，后面的肯定也没超时（因为是先进先出的）
             }
         }
     }
+    // [修改] 在锁外真正销毁物理连接：mysql_close 要和服务器通信，不让借连接的线程跟着等
+    for (Connection* p : expired) {
+        delete p;
+    }
 }
\ No newline at end of file
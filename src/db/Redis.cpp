@@ -1,105 +1,152 @@
 #include "db/Redis.h"
 #include <iostream>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <arpa/inet.h>
 
-Redis::Redis() : _publish_context(nullptr), _subcribe_context(nullptr) {
+Redis::Redis() : _subcribe_context(nullptr), _observing(false) {
 }
 
 Redis::~Redis() {
-    if (_publish_context != nullptr) {
-        redisFree(_publish_context);
-    }
     if (_subcribe_context != nullptr) {
         redisFree(_subcribe_context);
     }
 }
 
 bool Redis::connect() {
-    // 负责publish发布消息的上下文连接
-    _publish_context = redisConnect("127.0.0.1", 6379);
-    if (_publish_context == nullptr) {
-        std::cerr << "connect redis failed!" << std::endl;
+    // [修改] 负责publish发布消息的是一组连接，由后台线程批量发送
+    if (!_publisher.start("127.0.0.1", 6379, kPublishContexts)) {
         return false;
     }
 
     // 负责subscribe订阅消息的上下文连接
     _subcribe_context = redisConnect("127.0.0.1", 6379);
-    if (_subcribe_context == nullptr) {
+    if (_subcribe_context == nullptr || _subcribe_context->err) {
         std::cerr << "connect redis failed!" << std::endl;
+        if (_subcribe_context != nullptr) {
+            redisFree(_subcribe_context);
+            _subcribe_context = nullptr;
+        }
         return false;
     }
 
-    // 在单独的线程中，监听通道上的事件，有消息给业务层进行上报
-    std::thread t([&]() {
-        observer_channel_message();
-    });
-    t.detach();
+    // [修改] 接收线程等第一次订阅成功后再启动，见 subscribe
 
     std::cout << "connect redis-server success!" << std::endl;
     return true;
 }
 
 // 向redis指定的通道channel发布消息
-bool Redis::publish(int channel, std::string message) {
-    redisReply *reply = (redisReply *)redisCommand(_publish_context, "PUBLISH %d %s", channel, message.c_str());
-    if (nullptr == reply) {
-        std::cerr << "publish command failed!" << std::endl;
+bool Redis::publish(const std::string& channel, int userid, const std::string& message) {
+    // [修改] 信封: 4 字节接收者 userid (网络字节序) + 消息，用 %b 按长度发送
+    std::string envelope(4 + message.size(), '\0');
+    uint32_t userid_net = htonl(static_cast<uint32_t>(userid));
+    memcpy(&envelope[0], &userid_net, 4);
+    memcpy(&envelope[4], message.data(), message.size());
+
+    // [修改] 只是放进发送队列，不等 Redis 回复 (任意线程都可以调用)
+    return _publisher.publish(channel, std::move(envelope));
+}
+
+// 向redis指定的通道subscribe订阅消息
+bool Redis::subscribe(const std::string& channel) {
+    if (_subcribe_context == nullptr) {
+        return false; // 没有连上 redis (单机模式)
+    }
+    if (_observing) {
+        std::cerr << "subscribe after observer started: " << channel << std::endl;
+        return false;
+    }
+    // [修改] 接收线程还没启动，这里直接等 SUBSCRIBE 的确认，不存在和接收线程抢上下文的问题
+    redisReply* reply = static_cast<redisReply*>(redisCommand(_subcribe_context, "SUBSCRIBE %s", channel.c_str()));
+    if (reply == nullptr) {
+        std::cerr << "subscribe command failed!" << std::endl;
         return false;
     }
     freeReplyObject(reply);
+    _channels.push_back(channel);
+
+    // 在单独的线程中，监听通道上的事件，有消息给业务层进行上报
+    _observing = true;
+    std::thread t([this]() {
+        observer_channel_message();
+    });
+    t.detach();
     return true;
 }
 
-// 向redis指定的通道subscribe订阅消息
-bool Redis::subscribe(int channel) {
-    // SUBSCRIBE命令本身会造成线程阻塞等待通道里面发生消息，这里只做订阅通道，不接收通道消息
-    // 通道消息的接收专门在observer_channel_message函数中的独立线程中进行
-    // 只负责发送命令，不阻塞接收redis server响应消息，否则和notifyMsg线程抢占响应资源
-    if (REDIS_ERR == redisAppendCommand(_subcribe_context, "SUBSCRIBE %d", channel)) {
-        std::cerr << "subscribe command failed!" << std::endl;
+// [新增] 重连订阅连接并重新订阅所有通道
+bool Redis::resubscribe() {
+    if (_subcribe_context != nullptr) {
+        redisFree(_subcribe_context);
+    }
+    _subcribe_context = redisConnect("127.0.0.1", 6379);
+    if (_subcribe_context == nullptr || _subcribe_context->err) {
         return false;
     }
-    // redisBufferWrite可以循环发送缓冲区，直到缓冲区数据发送完毕（done被置为1）
-    int done = 0;
-    while (!done) {
-        if (REDIS_ERR == redisBufferWrite(_subcribe_context, &done)) {
-            std::cerr << "subscribe command failed!" << std::endl;
+    for (const std::string& channel : _channels) {
+        redisReply* reply = static_cast<redisReply*>(redisCommand(_subcribe_context, "SUBSCRIBE %s", channel.c_str()));
+        if (reply == nullptr) {
             return false;
         }
+        freeReplyObject(reply);
     }
     return true;
 }
 
 // 向redis指定的通道unsubscribe取消订阅消息
-bool Redis::unsubscribe(int channel) {
-    if (REDIS_ERR == redisAppendCommand(_subcribe_context, "UNSUBSCRIBE %d", channel)) {
-        std::cerr << "unsubscribe command failed!" << std::endl;
+bool Redis::unsubscribe(const std::string& channel) {
+    if (_subcribe_context == nullptr || _observing) {
         return false;
     }
-    int done = 0;
-    while (!done) {
-        if (REDIS_ERR == redisBufferWrite(_subcribe_context, &done)) {
-            std::cerr << "unsubscribe command failed!" << std::endl;
-            return false;
-        }
+    redisReply* reply = static_cast<redisReply*>(redisCommand(_subcribe_context, "UNSUBSCRIBE %s", channel.c_str()));
+    if (reply == nullptr) {
+        std::cerr << "unsubscribe command failed!" << std::endl;
+        return false;
     }
+    freeReplyObject(reply);
+    _channels.erase(std::remove(_channels.begin(), _channels.end(), channel), _channels.end());
     return true;
 }
 
 // 在独立线程中接收订阅通道中的消息
 void Redis::observer_channel_message() {
-    redisReply *reply = nullptr;
-    while (REDIS_OK == redisGetReply(_subcribe_context, (void **)&reply)) {
-        // 订阅收到的消息是一个带三元素的数组
-        if (reply != nullptr && reply->element != nullptr && reply->element[2] != nullptr && reply->element[2]->str != nullptr) {
-            // 给业务层上报通道上发生的消息
-            _notify_message_handler(atoi(reply->element[1]->str), reply->element[2]->str);
+    for (;;) {
+        redisReply *reply = nullptr;
+        while (REDIS_OK == redisGetReply(_subcribe_context, (void **)&reply)) {
+            // 订阅收到的消息是一个带三元素的数组
+            // [修改] 第三个元素是信封：前 4 字节是接收者 userid，后面是消息 (按长度取，可能含 '\0')
+            if (reply != nullptr && reply->element != nullptr && reply->elements == 3
+                && reply->element[2] != nullptr && reply->element[2]->str != nullptr && reply->element[2]->len >= 4) {
+                uint32_t userid_net = 0;
+                memcpy(&userid_net, reply->element[2]->str, 4);
+                // 给业务层上报通道上发生的消息
+                _notify_message_handler(static_cast<int>(ntohl(userid_net)),
+                                        std::string(reply->element[2]->str + 4, reply->element[2]->len - 4));
+            }
+
+            freeReplyObject(reply);
         }
 
-        freeReplyObject(reply);
+        // [修改] 连接断了不退出：重连并重新订阅，断开期间发来的消息由发布方按"没有订阅者"转存离线
+        std::cerr << ">>>>>>>>>>>>> observer_channel_message 连接断开，正在重连 <<<<<<<<<<<<<" << std::endl;
+        while (!resubscribe()) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(kReconnectDelay));
+        }
+        std::cout << "redis 订阅已恢复" << std::endl;
     }
-    std::cerr << ">>>>>>>>>>>>> observer_channel_message quit <<<<<<<<<<<<<" << std::endl;
 }
 
 void Redis::init_notify_handler(std::function<void(int, std::string)> fn) {
     this->_notify_message_handler = fn;
+}
+
+void Redis::init_undelivered_handler(std::function<void(int, std::string)> fn) {
+    // 发布的是信封，拆开后再交给业务层
+    _publisher.setUndeliveredCallback([fn](std::string envelope) {
+        uint32_t userid_net = 0;
+        memcpy(&userid_net, envelope.data(), 4);
+        fn(static_cast<int>(ntohl(userid_net)), envelope.substr(4));
+    });
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "db/RedisPublisher.h"
+#include <functional>
+#include <iostream>
+#include <iterator>
+
+RedisPublisher::RedisPublisher() : port_(0) {
+}
+
+RedisPublisher::~RedisPublisher() {
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stop = true;
+        }
+        worker->cv.notify_one();
+    }
+    for (auto& worker : workers_) {
+        worker->thread.join();
+        if (worker->context != nullptr) {
+            redisFree(worker->context);
+        }
+    }
+}
+
+bool RedisPublisher::start(const std::string& ip, int port, size_t contexts) {
+    ip_ = ip;
+    port_ = port;
+    for (size_t i = 0; i < contexts; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->context = redisConnect(ip_.c_str(), port_);
+        if (worker->context == nullptr || worker->context->err) {
+            std::cerr << "connect redis failed!" << std::endl;
+            if (worker->context != nullptr) {
+                redisFree(worker->context);
+            }
+            // 已经建好的连接也一并释放，线程还没有启动
+            for (auto& w : workers_) {
+                redisFree(w->context);
+            }
+            workers_.clear();
+            return false;
+        }
+        workers_.push_back(std::move(worker));
+    }
+
+    // 全部连上之后再启动线程，失败时不会留下跑了一半的线程
+    for (auto& worker : workers_) {
+        Worker* w = worker.get();
+        w->thread = std::thread([this, w]() { run(w); });
+    }
+    return true;
+}
+
+bool RedisPublisher::publish(const std::string& channel, std::string message) {
+    if (workers_.empty()) {
+        return false;
+    }
+
+    Worker* worker = workers_[std::hash<std::string>()(channel) % workers_.size()].get();
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (worker->queue.size() >= kMaxQueue) {
+            std::cerr << "redis publish queue full, message dropped!" << std::endl;
+            return false;
+        }
+        if (worker->queue.empty()) {
+            worker->firstAt = std::chrono::steady_clock::now();
+        }
+        worker->queue.push_back(Item{channel, std::move(message)});
+        // 第一条要让后台线程开始计时，攒够一批要让它立即发送
+        if (worker->queue.size() != 1 && worker->queue.size() < kMaxBatch) {
+            return true;
+        }
+    }
+    worker->cv.notify_one();
+    return true;
+}
+
+void RedisPublisher::run(Worker* worker) {
+    std::vector<Item> batch;
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    for (;;) {
+        worker->cv.wait(lock, [worker]() { return !worker->queue.empty() || worker->stop; });
+        if (worker->queue.empty()) {
+            return; // 要退出且没有剩余
+        }
+
+        auto deadline = worker->firstAt + std::chrono::microseconds(kFlushWindowUs);
+        worker->cv.wait_until(lock, deadline, [worker]() {
+            return worker->queue.size() >= kMaxBatch || worker->stop;
+        });
+
+        batch.swap(worker->queue);
+        lock.unlock();
+        bool ok = flush(worker, batch);
+        lock.lock();
+
+        if (!ok) {
+            // [新增] 没发出去的放回队头 (排在这期间新入队的前面，保持顺序)，等一会儿重连后再发
+            worker->queue.insert(worker->queue.begin(),
+                                 std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+            worker->cv.wait_for(lock, std::chrono::milliseconds(kRetryDelayMs), [worker]() { return worker->stop; });
+            if (worker->stop) {
+                std::cerr << "redis publisher 退出, " << worker->queue.size() << " messages dropped!" << std::endl;
+                return;
+            }
+            worker->firstAt = std::chrono::steady_clock::now();
+        }
+        batch.clear();
+    }
+}
+
+bool RedisPublisher::flush(Worker* worker, std::vector<Item>& batch) {
+    if (worker->context == nullptr || worker->context->err) {
+        // 上一次出错了，先重连
+        if (worker->context != nullptr) {
+            redisFree(worker->context);
+        }
+        worker->context = redisConnect(ip_.c_str(), port_);
+        if (worker->context == nullptr || worker->context->err) {
+            // [修改] 一条都没发出去，整批留着重试
+            std::cerr << "reconnect redis failed, " << batch.size() << " messages will be retried" << std::endl;
+            if (worker->context != nullptr) {
+                redisFree(worker->context);
+                worker->context = nullptr;
+            }
+            return false;
+        }
+    }
+
+    // 1. 所有命令先写进 hiredis 的输出缓冲区
+    for (const Item& item : batch) {
+        redisAppendCommand(worker->context, "PUBLISH %b %b",
+                           item.channel.data(), item.channel.size(),
+                           item.message.data(), item.message.size());
+    }
+
+    // 2. 读第一个回复时 hiredis 会把整个缓冲区一次写出去，然后依次读回复
+    for (size_t i = 0; i < batch.size(); ++i) {
+        redisReply* reply = nullptr;
+        if (REDIS_OK != redisGetReply(worker->context, (void**)&reply)) {
+            // [修改] 没收到回复的不能确定发出去了，留下来重连后重发 (宁可偶尔重复，也不丢消息)
+            std::cerr << "publish command failed! " << worker->context->errstr << std::endl;
+            batch.erase(batch.begin(), batch.begin() + i);
+            return false; // context->err 已置位，重试前会重连
+        }
+        // [新增] 回复是收到这条消息的订阅者个数，0 说明没有人收到，交还给调用者处理 (例如存成离线消息)
+        if (reply != nullptr && reply->type == REDIS_REPLY_INTEGER && reply->integer == 0 && undelivered_) {
+            undelivered_(std::move(batch[i].message));
+        }
+        freeReplyObject(reply);
+    }
+    return true;
+}
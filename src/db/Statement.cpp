@@ -0,0 +1,121 @@
+#include "db/Statement.h"
+#include <cstring>
+#include <iostream>
+
+StmtParams& StmtParams::addInt(long long value) {
+    params_.push_back(Param{MYSQL_TYPE_LONGLONG, value, std::string(), 0});
+    return *this;
+}
+
+StmtParams& StmtParams::addString(std::string value) {
+    params_.push_back(Param{MYSQL_TYPE_STRING, 0, std::move(value), 0});
+    return *this;
+}
+
+StmtParams& StmtParams::addBlob(std::string value) {
+    params_.push_back(Param{MYSQL_TYPE_BLOB, 0, std::move(value), 0});
+    return *this;
+}
+
+bool StmtParams::bind(MYSQL_STMT* stmt) {
+    binds_.assign(params_.size(), MYSQL_BIND());
+    for (size_t i = 0; i < params_.size(); ++i) {
+        Param& p = params_[i];
+        MYSQL_BIND& b = binds_[i];
+        std::memset(&b, 0, sizeof(b));
+        b.buffer_type = p.type;
+        if (p.type == MYSQL_TYPE_LONGLONG) {
+            b.buffer = &p.intValue;
+        } else {
+            p.length = static_cast<unsigned long>(p.strValue.size());
+            b.buffer = const_cast<char*>(p.strValue.data());
+            b.buffer_length = p.length;
+            b.length = &p.length;
+        }
+    }
+
+    if (mysql_stmt_bind_param(stmt, binds_.data())) {
+        std::cout << "绑定参数失败: " << mysql_stmt_error(stmt) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+StmtReader::StmtReader(MYSQL_STMT* stmt) : stmt_(stmt) {
+    if (stmt_ == nullptr) {
+        return;
+    }
+
+    unsigned int count = mysql_stmt_field_count(stmt_);
+    binds_.assign(count, MYSQL_BIND());
+    columns_.assign(count, Column{0, 0});
+    for (unsigned int i = 0; i < count; ++i) {
+        MYSQL_BIND& b = binds_[i];
+        std::memset(&b, 0, sizeof(b));
+        b.buffer_type = MYSQL_TYPE_STRING;
+        b.length = &columns_[i].length;
+        b.is_null = &columns_[i].isNull;
+    }
+
+    if (mysql_stmt_bind_result(stmt_, binds_.data())) {
+        std::cout << "绑定结果失败: " << mysql_stmt_error(stmt_) << std::endl;
+        mysql_stmt_free_result(stmt_);
+        stmt_ = nullptr;
+    }
+}
+
+StmtReader::~StmtReader() {
+    if (stmt_ != nullptr) {
+        mysql_stmt_free_result(stmt_);
+    }
+}
+
+StmtReader::StmtReader(StmtReader&& other) noexcept
+    : stmt_(other.stmt_),
+      binds_(std::move(other.binds_)),
+      columns_(std::move(other.columns_))
+{
+    other.stmt_ = nullptr;
+    // 绑定里记录的是 vector 内部缓冲区的地址，移动 vector 不会改变它们
+}
+
+bool StmtReader::next() {
+    if (stmt_ == nullptr) {
+        return false;
+    }
+    int ret = mysql_stmt_fetch(stmt_);
+    // 0 长度绑定时，非空的列都会报告截断，这正是预期的
+    return ret == 0 || ret == MYSQL_DATA_TRUNCATED;
+}
+
+bool StmtReader::isNull(unsigned int col) const {
+    return columns_[col].isNull;
+}
+
+long long StmtReader::getInt(unsigned int col) {
+    long long value = 0;
+    if (columns_[col].isNull) {
+        return value;
+    }
+    MYSQL_BIND b;
+    std::memset(&b, 0, sizeof(b));
+    b.buffer_type = MYSQL_TYPE_LONGLONG;
+    b.buffer = &value;
+    mysql_stmt_fetch_column(stmt_, &b, col, 0);
+    return value;
+}
+
+std::string StmtReader::getString(unsigned int col) {
+    std::string value;
+    if (columns_[col].isNull || columns_[col].length == 0) {
+        return value;
+    }
+    value.resize(columns_[col].length);
+    MYSQL_BIND b;
+    std::memset(&b, 0, sizeof(b));
+    b.buffer_type = MYSQL_TYPE_STRING;
+    b.buffer = &value[0];
+    b.buffer_length = columns_[col].length;
+    mysql_stmt_fetch_column(stmt_, &b, col, 0);
+    return value;
+}
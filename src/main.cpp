@@ -1,10 +1,47 @@
 #include "server/ChatServer.h"
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
-int main() {
+int main(int argc, char** argv) {
     try {
+        // 用法: ./ChatServer [ioThreadNum] [--reuseport] [--cpu-affinity] [--idle-timeout=秒]
+        //                   [--db-workers=N] [--node-id=ID]
+        //   ioThreadNum    : Sub Reactor 线程数，默认等于 CPU 核心数，0 表示单 Reactor
+        //   --reuseport    : 每个 IO 线程各自 SO_REUSEPORT 监听并 accept
+        //   --cpu-affinity : reuseport 模式下 IO 线程绑核，并按 CPU 分配新连接
+        //   --idle-timeout : 空闲连接超时时间，默认 30 秒，0 表示不检测
+        //   --db-workers   : 访问数据库业务的线程数，默认为 CPU 核心数的 2 倍
+        //   --node-id      : 本节点在集群里的 id (需唯一)，默认为 主机名:端口
+        int ioThreadNum = static_cast<int>(std::thread::hardware_concurrency());
+        bool reusePort = false;
+        bool cpuAffinity = false;
+        int idleTimeout = 30;
+        int dbWorkers = 0;
+        std::string nodeId;
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--reuseport") == 0) {
+                reusePort = true;
+            } else if (strcmp(argv[i], "--cpu-affinity") == 0) {
+                cpuAffinity = true;
+            } else if (strncmp(argv[i], "--idle-timeout=", 15) == 0) {
+                idleTimeout = atoi(argv[i] + 15);
+            } else if (strncmp(argv[i], "--db-workers=", 13) == 0) {
+                dbWorkers = atoi(argv[i] + 13);
+            } else if (strncmp(argv[i], "--node-id=", 10) == 0) {
+                nodeId = argv[i] + 10;
+            } else {
+                ioThreadNum = atoi(argv[i]);
+            }
+        }
+
         // 创建服务器实例，监听 8888 端口
-        ChatServer server(8888);
+        ChatServer server(8888, ioThreadNum, reusePort);
+        server.setCpuAffinity(cpuAffinity);
+        server.setIdleTimeout(idleTimeout);
+        server.setWorkerThreads(dbWorkers);
+        server.setNodeId(nodeId);
         
         // 启动服务循环
         server.start();
@@ -13,4 +50,4 @@ int main() {
         std::cerr << "服务器异常退出: " << e.what() << std::endl;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,84 @@
+#include "net/ChainBuffer.h"
+#include <sys/uio.h> // writev
+#include <errno.h>
+#include <algorithm> // std::min, std::copy
+
+// 每个连接最多缓存几块空闲内存
+static const size_t kMaxFreeBlocks = 2;
+
+ChainBuffer::ChainBuffer() : readable_(0) {
+}
+
+std::unique_ptr<char[]> ChainBuffer::allocBlock() {
+    if (!freeBlocks_.empty()) {
+        std::unique_ptr<char[]> data = std::move(freeBlocks_.back());
+        freeBlocks_.pop_back();
+        return data;
+    }
+    return std::unique_ptr<char[]>(new char[kBlockSize]);
+}
+
+void ChainBuffer::releaseBlock(std::unique_ptr<char[]> data) {
+    if (freeBlocks_.size() < kMaxFreeBlocks) {
+        freeBlocks_.push_back(std::move(data));
+    }
+}
+
+void ChainBuffer::append(const char* data, size_t len) {
+    readable_ += len;
+
+    while (len > 0) {
+        // 链尾的块写满了 (或者还没有块)，挂一块新的
+        if (blocks_.empty() || blocks_.back().writeIndex == kBlockSize) {
+            blocks_.push_back(Block{allocBlock(), 0, 0});
+        }
+
+        Block& tail = blocks_.back();
+        size_t n = std::min(len, kBlockSize - tail.writeIndex);
+        std::copy(data, data + n, tail.data.get() + tail.writeIndex);
+        tail.writeIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::retrieve(size_t len) {
+    readable_ -= std::min(len, readable_);
+
+    while (len > 0 && !blocks_.empty()) {
+        Block& head = blocks_.front();
+        size_t n = std::min(len, head.writeIndex - head.readIndex);
+        head.readIndex += n;
+        len -= n;
+
+        // 整块都发完了，弹出并回收
+        if (head.readIndex == head.writeIndex) {
+            releaseBlock(std::move(head.data));
+            blocks_.pop_front();
+        }
+    }
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* saveErrno) {
+    struct iovec vec[kMaxIov];
+    int iovcnt = 0;
+
+    for (auto it = blocks_.begin(); it != blocks_.end() && iovcnt < kMaxIov; ++it) {
+        vec[iovcnt].iov_base = it->data.get() + it->readIndex;
+        vec[iovcnt].iov_len = it->writeIndex - it->readIndex;
+        ++iovcnt;
+    }
+
+    if (iovcnt == 0) {
+        return 0;
+    }
+
+    // writev 可以聚集写，一次系统调用把多个块都交给内核
+    const ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0) {
+        *saveErrno = errno;
+    } else {
+        retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
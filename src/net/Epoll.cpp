@@ -2,11 +2,14 @@
 #include <unistd.h>     // close
 #include <cstring>      // bzero (清空内存)
 #include <stdexcept>    // 异常处理
+#include <cerrno>
 
-// 设定每次最多处理多少个事件，1024 是个经验值，够用了
+// 事件数组的初始大小，1024 是个经验值，一般够用了
 #define MAX_EVENTS 1024
+// 事件数组最多扩容到多大，防止无限增长
+#define MAX_EVENTS_LIMIT 65536
 
-Epoll::Epoll()
+Epoll::Epoll() : events(MAX_EVENTS), eventsFull(false)
 {
     // 创建 epoll 实例
     // epoll_create1(0) 是较新的写法，比老版 epoll_create 更推荐
@@ -14,10 +17,6 @@ Epoll::Epoll()
     if (epollFd == -1) {
         throw std::runtime_error("Epoll 创建失败！");
     }
-
-    // 2. 申请一段内存，用来存放操作系统告诉我们的“活跃事件”
-    events = new epoll_event[MAX_EVENTS];
-    bzero(events, sizeof(*events) * MAX_EVENTS);
 }
 
 Epoll::~Epoll()
@@ -25,15 +24,14 @@ Epoll::~Epoll()
     // 关闭 epoll 文件描述符
     if (epollFd != -1) {
         close(epollFd); // 关掉句柄
-        delete[] events; // 释放内存，防止内存泄露
     }
 }
 
-void Epoll::updateChannel(int fd, int op, uint32_t events_flag) {
+void Epoll::updateChannel(int fd, int op, uint32_t events_flag, Channel* channel) {
     struct epoll_event ev;
     bzero(&ev, sizeof(ev));
     
-    ev.data.fd = fd;      // 记录是哪个 Socket
+    ev.data.ptr = channel; // 记录由谁来处理这个 fd 的事件
     ev.events = events_flag; // 记录我们关心什么事件 (读? 写? 边缘触发?)
 
     // epoll_ctl 是“控制”函数，用来增删改监听列表
@@ -42,25 +40,30 @@ void Epoll::updateChannel(int fd, int op, uint32_t events_flag) {
     }
 }
 
-std::vector<epoll_event> Epoll::poll(int timeout) {
-    std::vector<epoll_event> activeEvents;
-    
+Epoll::EventList Epoll::poll(int timeout) {
+    // 上一次把数组填满了，说明还有事件没取完，先扩容 (不能在上层遍历期间扩容，所以放到这里)
+    if (eventsFull && events.size() < MAX_EVENTS_LIMIT) {
+        events.resize(events.size() * 2);
+    }
+
     // 3. 核心等待函数
     // epollFd: 谁在等？
     // events: 发生的事件存哪？
-    // MAX_EVENTS: 最多存多少个？
+    // events.size(): 最多存多少个？
     // timeout: 等多久？
     // 返回值 nfds: 实际发生了多少个事件
-    int nfds = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+    int nfds = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeout);
     
     if (nfds == -1) {
+        if (errno == EINTR) {
+            // 被信号打断，当作没有事件
+            eventsFull = false;
+            return EventList(events.data(), 0);
+        }
         throw std::runtime_error("Epoll wait error");
     }
 
-    // 4. 把数组里的数据转移到 vector 中返回给上层
-    for (int i = 0; i < nfds; ++i) {
-        activeEvents.push_back(events[i]);
-    }
-    
-    return activeEvents;
-}
\ No newline at end of file
+    // 4. 直接把内部数组的这一段交给上层遍历，不再拷贝到 vector
+    eventsFull = (static_cast<size_t>(nfds) == events.size());
+    return EventList(events.data(), nfds);
+}
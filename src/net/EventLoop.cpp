@@ -0,0 +1,157 @@
+#include "net/EventLoop.h"
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <stdexcept>
+#include <iostream>
+
+// 当前线程正在运行的 EventLoop，用来判断调用者是否在 loop 线程里
+static thread_local EventLoop* t_loopInThisThread = nullptr;
+
+// 全局递增的定时器 id，任意线程都可以直接拿到 id，再把真正的添加操作投递给 loop
+static std::atomic<uint64_t> s_nextTimerId(1);
+
+EventLoop::EventLoop()
+    : epoll_(std::make_unique<Epoll>()),
+      wakeupFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      wakeupPending_(false),
+      connectionCount_(0)
+{
+    if (wakeupFd_ == -1) {
+        throw std::runtime_error("eventfd 创建失败！");
+    }
+    // eventfd 用水平触发即可，handleWakeup 每次都会把计数读空
+    registerFd(wakeupFd_, EPOLLIN, std::bind(&EventLoop::handleWakeup, this));
+    registerFd(timerQueue_.fd(), EPOLLIN, std::bind(&TimerQueue::handleRead, &timerQueue_));
+
+    // 时间轮每秒走一格
+    runEvery(1.0, std::bind(&EventLoop::handleIdleTick, this));
+}
+
+EventLoop::~EventLoop() {
+    // 智能指针会自动释放 Epoll 和连接对象
+    ::close(wakeupFd_);
+}
+
+EventLoop::TimerId EventLoop::runAfter(double delay, Functor cb) {
+    TimerId id = s_nextTimerId.fetch_add(1, std::memory_order_relaxed);
+    auto when = TimerQueue::Clock::now() + std::chrono::duration_cast<TimerQueue::Clock::duration>(std::chrono::duration<double>(delay));
+    runInLoop([this, id, when, cb = std::move(cb)]() mutable {
+        timerQueue_.addTimer(id, when, 0, std::move(cb));
+    });
+    return id;
+}
+
+EventLoop::TimerId EventLoop::runEvery(double interval, Functor cb) {
+    TimerId id = s_nextTimerId.fetch_add(1, std::memory_order_relaxed);
+    auto when = TimerQueue::Clock::now() + std::chrono::duration_cast<TimerQueue::Clock::duration>(std::chrono::duration<double>(interval));
+    runInLoop([this, id, when, interval, cb = std::move(cb)]() mutable {
+        timerQueue_.addTimer(id, when, interval, std::move(cb));
+    });
+    return id;
+}
+
+void EventLoop::cancel(TimerId id) {
+    runInLoop([this, id]() {
+        timerQueue_.cancel(id);
+    });
+}
+
+void EventLoop::handleIdleTick() {
+    idleWheel_.tick();
+}
+
+bool EventLoop::isInLoopThread() const {
+    return t_loopInThisThread == this;
+}
+
+void EventLoop::runInLoop(Functor cb) {
+    if (isInLoopThread()) {
+        cb();
+    } else {
+        queueInLoop(std::move(cb));
+    }
+}
+
+void EventLoop::queueInLoop(Functor cb) {
+    pendingFunctors_.push(std::move(cb));
+
+    // 只有第一个把标志从 false 改成 true 的生产者需要真正写 eventfd
+    if (!wakeupPending_.exchange(true)) {
+        wakeup();
+    }
+}
+
+void EventLoop::wakeup() {
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+    if (n != sizeof(one)) {
+        std::cout << "EventLoop::wakeup 写入 " << n << " 字节，期望 8 字节" << std::endl;
+    }
+}
+
+void EventLoop::handleWakeup() {
+    uint64_t count = 0;
+    ::read(wakeupFd_, &count, sizeof(count));
+
+    // 必须先清标志再取任务：清标志之后入队的任务一定会再触发一次唤醒
+    wakeupPending_.store(false);
+
+    Functor cb;
+    while (pendingFunctors_.pop(cb)) {
+        cb();
+    }
+}
+
+void EventLoop::registerFd(int fd, uint32_t events, FdCallback cb) {
+    fdChannels_.push_back(std::make_unique<FdChannel>(std::move(cb)));
+    epoll_->updateChannel(fd, EPOLL_CTL_ADD, events, fdChannels_.back().get());
+}
+
+void EventLoop::addConnection(const TcpConnection::ptr& conn) {
+    // 主 Reactor 线程调用时投递到本 loop，连接表始终只被 loop 线程修改
+    runInLoop([this, conn]() {
+        addConnectionInLoop(conn);
+    });
+}
+
+void EventLoop::addConnectionInLoop(const TcpConnection::ptr& conn) {
+    int fd = conn->getFd();
+    if (static_cast<size_t>(fd) >= connections_.size()) {
+        connections_.resize(fd + 1);
+    }
+    connections_[fd] = conn;
+    connectionCount_.fetch_add(1, std::memory_order_relaxed);
+
+    // 挂到空闲检测时间轮上，之后每次收到数据只会在轮上挪个位置
+    idleWheel_.add(conn.get());
+
+    // 先入表再加入 Epoll，data.ptr 直接指向连接对象
+    epoll_->updateChannel(fd, EPOLL_CTL_ADD, EPOLLIN | EPOLLET | EPOLLRDHUP, conn.get());
+}
+
+TcpConnection::ptr EventLoop::removeConnection(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= connections_.size() || !connections_[fd]) {
+        return nullptr;
+    }
+    TcpConnection::ptr conn = std::move(connections_[fd]);
+    connectionCount_.fetch_sub(1, std::memory_order_relaxed);
+    idleWheel_.remove(conn.get());
+
+    // 延迟到本轮事件处理完再释放
+    closingConnections_.push_back(conn);
+    return conn;
+}
+
+void EventLoop::loop() {
+    t_loopInThisThread = this;
+
+    while (true) {
+        // 等待事件，data.ptr 里就是处理对象，直接分发，不查表、不加锁
+        for (auto& event : epoll_->poll()) {
+            static_cast<Channel*>(event.data.ptr)->handleEvent(event.events);
+        }
+
+        // 本轮关闭的连接在这里才真正释放
+        closingConnections_.clear();
+    }
+}
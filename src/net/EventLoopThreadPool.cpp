@@ -0,0 +1,44 @@
+#include "net/EventLoopThreadPool.h"
+#include <iostream>
+
+EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, int numThreads)
+    : baseLoop_(baseLoop),
+      numThreads_(numThreads < 0 ? 0 : numThreads),
+      next_(0)
+{
+}
+
+EventLoopThreadPool::~EventLoopThreadPool() {
+    // loop 线程是分离的，跟随进程一起结束
+}
+
+void EventLoopThreadPool::start(const ThreadInitCallback& cb) {
+    for (int i = 0; i < numThreads_; ++i) {
+        loops_.push_back(std::make_unique<EventLoop>());
+        EventLoop* loop = loops_.back().get();
+
+        std::thread t([loop, cb, i]() {
+            if (cb) {
+                cb(loop, i);
+            }
+            loop->loop();
+        });
+        t.detach();
+    }
+
+    // 单 Reactor 模式：baseLoop 由调用者自己运行，这里只做初始化
+    if (numThreads_ == 0 && cb) {
+        cb(baseLoop_, 0);
+    }
+    std::cout << "EventLoopThreadPool 启动完成，Sub Reactor 数量: " << numThreads_ << std::endl;
+}
+
+EventLoop* EventLoopThreadPool::getNextLoop() {
+    if (loops_.empty()) {
+        return baseLoop_;
+    }
+    EventLoop* loop = loops_[next_].get();
+    next_ = (next_ + 1) % loops_.size();
+    return loop;
+}
+
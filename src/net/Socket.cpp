@@ -92,6 +92,25 @@ int Socket::accept(sockaddr_in *addr)
 
 
 
+}
+
+void Socket::setReusePort(bool on)
+{
+    int optval = on ? 1 : 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) == -1) {
+        throw std::runtime_error("Socket setsockopt SO_REUSEPORT error!");
+    }
+}
+
+void Socket::setIncomingCpu(int cpu)
+{
+#ifdef SO_INCOMING_CPU
+    if (setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == -1) {
+        throw std::runtime_error("Socket setsockopt SO_INCOMING_CPU error!");
+    }
+#else
+    (void)cpu; // 老内核头文件没有这个选项，退化为内核默认的哈希分配
+#endif
 }
 
 int Socket::getFd() const
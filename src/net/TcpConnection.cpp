@@ -1,5 +1,6 @@
 #include "net/TcpConnection.h"
 #include "net/Socket.h" 
+#include "net/EventLoop.h"
 // [修正] 因为 CMake 包含了 proto 目录，所以直接引用文件名即可，不要加 proto/ 前缀
 #include "msg.pb.h" 
 #include "server/chatservice.hpp"
@@ -8,26 +9,53 @@
 #include <cerrno>
 #include <cstring>      // memcpy
 #include <arpa/inet.h>  // ntohl
+#include <sys/uio.h>    // writev
+#include <sys/socket.h> // shutdown
 
-TcpConnection::TcpConnection(Epoll* epoll, int fd) 
-    : epoll_(epoll),
+TcpConnection::TcpConnection(EventLoop* loop, int fd) 
+    : loop_(loop),
+      epoll_(loop->getEpoll()),
       socket_(std::make_unique<Socket>(fd)),
       readBuffer_(),
       writeEventEnabled_(false),
       closed_(false),
-      lastActiveTime_(time(nullptr)) // [Initialize] 初始化活跃时间
+      disconnected_(false),
+      userId_(-1)
 {
     socket_->setNonBlocking();
 }
 
-void TcpConnection::refreshAliveTime() {
-    lastActiveTime_ = time(nullptr);
+void TcpConnection::onExpire() {
+    std::cout << "[Heartbeat] Connection timeout fd=" << socket_->getFd() << ", kicking out..." << std::endl;
+    // shutdown 会触发 loop 的 onRead -> read 0 -> closeCallback，走统一的关闭流程
+    shutdown(socket_->getFd(), SHUT_RDWR);
 }
 
 TcpConnection::~TcpConnection() {
     std::cout << "TcpConnection 资源释放，关闭 fd=" << socket_->getFd() << std::endl;
 }
 
+void TcpConnection::handleEvent(uint32_t revents) {
+    // 本轮事件里连接已经被关闭 (对象还没释放)，直接忽略
+    if (closed_.load()) {
+        return;
+    }
+
+    // 优先处理异常/对端半关闭事件
+    if (revents & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        onRead();
+        return;
+    }
+
+    if (revents & EPOLLIN) {
+        onRead();
+    }
+
+    if (revents & EPOLLOUT) {
+        onWrite();
+    }
+}
+
 void TcpConnection::onRead() {
     int saveErrno = 0;
 
@@ -36,18 +64,16 @@ void TcpConnection::onRead() {
         ssize_t n = readBuffer_.readFd(socket_->getFd(), &saveErrno);
 
         if (n > 0) {
-            // [新增] 只要读到数据，就更新活跃时间
-            refreshAliveTime();
+            // [新增] 只要读到数据，就在空闲时间轮上挪到最新的槽 (重新计时)
+            loop_->getIdleWheel().refresh(this);
 
-            // [DEBUG] 打印接收到的数据长度
-            std::cout << "[DEBUG] Received " << n << " bytes. Buffer readable: " << readBuffer_.readableBytes() << std::endl;
+            // [修改] 去掉逐帧的调试打印：多个 IO 线程同时往 cout 写既会竞争也会拖慢收包
 
             // [核心逻辑] 循环处理 Buffer 中的数据，解决粘包
             while (true) {
                 // 第一步：检查 Buffer 里的数据够不够解析出一个包头 (4字节)
                 // 包头存放整个包的长度
                 if (readBuffer_.readableBytes() < 4) {
-                    std::cout << "[DEBUG] Buffer data < 4 bytes, waiting..." << std::endl;
                     break; // 数据不够，等待下次读取
                 }
 
@@ -57,20 +83,13 @@ void TcpConnection::onRead() {
                 // 使用 memcpy 避免字节对齐问题
                 memcpy(&len, readBuffer_.peek(), 4);
                 // 网络字节序(大端) 转 主机字节序(小端)
-                int32_t net_len = len; // 保存网络序以便调试
                 len = ntohl(len);
 
-                // [DEBUG] 打印头部信息
-                std::cout << "[DEBUG] Header raw: " << std::hex << net_len << std::dec
-                          << ", Parsed len: " << len
-                          << ", Needed total: " << (4 + len)
-                          << ", Readable: " << readBuffer_.readableBytes() << std::endl;
-
                 // 安全检查：如果长度非常离谱（比如过大），可能是恶意攻击
                 if (len < 4 || len > 65536) { // 最小长度是4 (只有MsgID，没有包体)
                     std::cout << "错误：非法的数据包长度 " << len << "，关闭连接" << std::endl;
                     closed_.store(true);
-                    epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_DEL, 0);
+                    epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_DEL, 0, nullptr);
                     if (closeCallback_) closeCallback_(socket_->getFd());
                     return;
                 }
@@ -82,28 +101,24 @@ void TcpConnection::onRead() {
                 }
 
                 // --- 数据完整，开始拆包 ---
+                // 整个包都直接在 Buffer 上解析，不生成任何临时 string
 
-                // 1. 先移除 4 字节的包头 (Length)
-                readBuffer_.retrieve(4);
-
-                // 2. 再解析 4 字节的 MsgID (业务类型)
+                // 1. 解析包头后面 4 字节的 MsgID (业务类型)
                 int32_t msgid;
-                std::string msgidStr = readBuffer_.retrieveAsString(4);
-                memcpy(&msgid, msgidStr.data(), 4);
+                memcpy(&msgid, readBuffer_.peek() + 4, 4);
                 msgid = ntohl(msgid);
 
-                // 3. 最后取出剩下的数据 (Protobuf 序列化后的数据)
+                // 2. 剩下的数据 (Protobuf 序列化后的数据) 只是 Buffer 上的一段视图
                 // 包体总长度 len - 4 (MsgID占用的长度)
-                std::string data = readBuffer_.retrieveAsString(len - 4);
+                std::string_view data(readBuffer_.peek() + 8, len - 4);
 
-                std::cout << "收到数据: MsgID=" << msgid << " DataLen=" << data.size() << std::endl;
+                // 3. [关键] 调用业务层进行分发处理
+                // 把当前连接对象(shared_ptr)和数据视图传给业务层，由它按消息id查表分发
+                // 视图只在这次调用期间有效，需要异步处理的数据由业务层自己拷走
+                ChatService::instance()->dispatch(msgid, shared_from_this(), data);
 
-                // 4. [关键] 调用业务层进行分发处理
-                // 获取对应消息id的处理器
-                auto handler = ChatService::instance()->getHandler(msgid);
-
-                // 把当前连接对象(shared_ptr)和数据传给业务层
-                handler(shared_from_this(), data);
+                // 4. 处理完之后再移动读指针，丢弃 包头(4) + 包体(len)
+                readBuffer_.retrieve(4 + len);
             }
             continue;
         }
@@ -111,7 +126,7 @@ void TcpConnection::onRead() {
         if (n == 0) {
             std::cout << "客户端断开连接 fd=" << socket_->getFd() << std::endl;
             closed_.store(true);
-            epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_DEL, 0);
+            epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_DEL, 0, nullptr);
             if (closeCallback_) {
                 closeCallback_(socket_->getFd());
             }
@@ -127,7 +142,7 @@ void TcpConnection::onRead() {
 
         std::cout << "TcpConnection 读取数据出错！errno=" << saveErrno << std::endl;
         closed_.store(true);
-        epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_DEL, 0);
+        epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_DEL, 0, nullptr);
         if (closeCallback_) {
             closeCallback_(socket_->getFd());
         }
@@ -136,87 +151,147 @@ void TcpConnection::onRead() {
 }
 
 void TcpConnection::onWrite() {
-    std::lock_guard<std::mutex> lock(sendMutex_);
-
-    if (closed_.load() || socket_->getFd() == -1) {
+    if (closed_.load() || disconnected_ || socket_->getFd() == -1) {
         return;
     }
 
     while (!writeBuffer_.empty()) {
-        ssize_t n = ::write(socket_->getFd(), writeBuffer_.data(), writeBuffer_.size());
+        // writev 一次把多个块交给内核，已发出的部分在 ChainBuffer 内部只做下标移动/弹块
+        int saveErrno = 0;
+        ssize_t n = writeBuffer_.writeFd(socket_->getFd(), &saveErrno);
         if (n > 0) {
-            writeBuffer_.erase(0, static_cast<size_t>(n));
             continue;
         }
 
-        if (n == -1 && errno == EINTR) {
+        if (n == -1 && saveErrno == EINTR) {
             continue;
         }
 
-        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        if (n == -1 && (saveErrno == EAGAIN || saveErrno == EWOULDBLOCK)) {
             return; // 当前不可写，等待下一次 EPOLLOUT
         }
 
-        std::cout << "TcpConnection onWrite 发送失败 errno=" << errno << std::endl;
+        // [修改] EPIPE/ECONNRESET 等硬错误：连接已经不可用，不能当成"发完了"
+        handleWriteError(saveErrno);
         return;
     }
 
     if (writeEventEnabled_) {
-        epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_MOD, EPOLLIN | EPOLLET | EPOLLRDHUP);
+        epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_MOD, EPOLLIN | EPOLLET | EPOLLRDHUP, this);
         writeEventEnabled_ = false;
     }
+
+    // [新增] 积压的数据都发完了，通知等待的人 (回调里可能再登记新的，所以先换出来)
+    if (!flushCallbacks_.empty()) {
+        std::vector<std::function<void()>> callbacks;
+        callbacks.swap(flushCallbacks_);
+        for (auto& cb : callbacks) {
+            cb();
+        }
+    }
 }
 
-// [新增] 按照自定义协议发送数据: 4字节长度 + 4字节MsgID + Data
-void TcpConnection::send(int msgid, std::string data) {
-    if (closed_.load() || socket_->getFd() == -1) return;
+// [新增] 发送缓冲区已经空了就立即回调，否则等 onWrite 把积压的数据发完
+// 跨线程时和 send 走同一个队列，所以排在调用之前的 send 后面
+void TcpConnection::runAfterFlush(std::function<void()> cb) {
+    auto self = shared_from_this();
+    loop_->runInLoop([self, cb = std::move(cb)]() mutable {
+        if (self->closed_.load() || self->disconnected_) {
+            return;
+        }
+        if (self->writeBuffer_.empty()) {
+            cb();
+        } else {
+            self->flushCallbacks_.push_back(std::move(cb));
+        }
+    });
+}
 
-    // 1. 计算总长度: MsgID(4字节) + Data长度
-    int32_t len = 4 + data.size();
-    
-    // 2. 将整数转为网络字节序 (大端)
-    int32_t len_net = htonl(len);
+// 组装 8 字节包头: 4字节长度(MsgID+Data) + 4字节MsgID，均为网络字节序
+static void encodeHeader(char* header, int msgid, size_t dataLen) {
+    int32_t len_net = htonl(static_cast<int32_t>(4 + dataLen));
     int32_t msgid_net = htonl(msgid);
+    memcpy(header, &len_net, 4);
+    memcpy(header + 4, &msgid_net, 4);
+}
 
-    // 3. 组装发送缓冲区
-    std::string sendBuf;
-    sendBuf.resize(4 + 4 + data.size());
+// [新增] 按照自定义协议发送数据: 4字节长度 + 4字节MsgID + Data
+// 包头放在栈上，和 Data 作为两个 iovec 一起 writev，不再拼接成一个新的 string
+void TcpConnection::send(int msgid, std::string_view data) {
+    if (closed_.load() || socket_->getFd() == -1) return;
 
-    // 填入长度
-    memcpy(sendBuf.data(), &len_net, 4);
-    // 填入MsgID
-    memcpy(sendBuf.data() + 4, &msgid_net, 4);
-    // 填入数据
-    memcpy(sendBuf.data() + 8, data.data(), data.size());
+    if (loop_->isInLoopThread()) {
+        char header[8];
+        encodeHeader(header, msgid, data.size());
+        writeInLoop(header, sizeof(header), data.data(), data.size());
+    } else {
+        // 跨线程只能拷贝一份；调用方不再需要 data 时应该用 std::move 走右值版本
+        send(msgid, std::string(data));
+    }
+}
 
-    // 4. 发送 
-    this->send(sendBuf);
+void TcpConnection::send(int msgid, std::string&& data) {
+    if (closed_.load() || socket_->getFd() == -1) return;
+
+    if (loop_->isInLoopThread()) {
+        char header[8];
+        encodeHeader(header, msgid, data.size());
+        writeInLoop(header, sizeof(header), data.data(), data.size());
+    } else {
+        // 把 data 移动进任务里，不拷贝字节
+        auto self = shared_from_this();
+        loop_->queueInLoop([self, msgid, data = std::move(data)]() {
+            char header[8];
+            encodeHeader(header, msgid, data.size());
+            self->writeInLoop(header, sizeof(header), data.data(), data.size());
+        });
+    }
 }
 
 // 发送数据的方法
 void TcpConnection::send(std::string msg) {
-    // [新增] 加锁保护，防止多线程同时 write 导致数据错乱
-    std::lock_guard<std::mutex> lock(sendMutex_);
-
     if (closed_.load() || socket_->getFd() == -1) {
         return;
     }
 
-    // 如果已经有待发送数据，直接入队，等待 EPOLLOUT flush
-    if (!writeBuffer_.empty()) {
-        writeBuffer_.append(msg);
-        if (!writeEventEnabled_) {
-            epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_MOD, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP);
-            writeEventEnabled_ = true;
-        }
+    // 写操作只允许发生在所属 loop 线程，这样 writeBuffer_ 和 EPOLLOUT 状态都不需要加锁
+    if (loop_->isInLoopThread()) {
+        writeInLoop(nullptr, 0, msg.data(), msg.size());
+    } else {
+        // 业务线程 / Redis 订阅线程：把消息投递给 loop，shared_ptr 保证连接在任务执行前不会析构
+        auto self = shared_from_this();
+        loop_->queueInLoop([self, msg = std::move(msg)]() {
+            self->writeInLoop(nullptr, 0, msg.data(), msg.size());
+        });
+    }
+}
+
+void TcpConnection::writeInLoop(const char* header, size_t headerLen,
+                                const char* data, size_t len) {
+    if (closed_.load() || disconnected_ || socket_->getFd() == -1) {
         return;
     }
 
-    size_t total = msg.size();
+    size_t total = headerLen + len;
     size_t sent = 0;
 
-    while (sent < total) {
-        ssize_t n = ::write(socket_->getFd(), msg.data() + sent, total - sent);
+    // 发送缓冲区为空时才能直接写，否则必须排在已有数据后面，保证顺序
+    while (writeBuffer_.empty() && sent < total) {
+        struct iovec vec[2];
+        int iovcnt = 0;
+        if (sent < headerLen) {
+            vec[iovcnt].iov_base = const_cast<char*>(header + sent);
+            vec[iovcnt].iov_len = headerLen - sent;
+            ++iovcnt;
+        }
+        size_t dataSent = sent < headerLen ? 0 : sent - headerLen;
+        if (dataSent < len) {
+            vec[iovcnt].iov_base = const_cast<char*>(data + dataSent);
+            vec[iovcnt].iov_len = len - dataSent;
+            ++iovcnt;
+        }
+
+        ssize_t n = ::writev(socket_->getFd(), vec, iovcnt);
 
         if (n > 0) {
             sent += static_cast<size_t>(n);
@@ -231,16 +306,33 @@ void TcpConnection::send(std::string msg) {
             break;
         }
 
-        std::cout << "TcpConnection 发送数据失败 errno=" << errno << std::endl;
+        // [修改] 硬错误：没发出去的数据不能留在原地假装发完了，直接断开
+        handleWriteError(errno);
         return;
     }
 
     // 还有没发完的数据，放入发送缓冲并开启 EPOLLOUT 事件续传
     if (sent < total) {
-        writeBuffer_.append(msg.data() + sent, total - sent);
+        if (sent < headerLen) {
+            writeBuffer_.append(header + sent, headerLen - sent);
+        }
+        size_t dataSent = sent < headerLen ? 0 : sent - headerLen;
+        writeBuffer_.append(data + dataSent, len - dataSent);
+
         if (!writeEventEnabled_) {
-            epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_MOD, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP);
+            epoll_->updateChannel(socket_->getFd(), EPOLL_CTL_MOD, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, this);
             writeEventEnabled_ = true;
         }
     }
-}
\ No newline at end of file
+}
+
+// [新增] 写出错 (EPIPE/ECONNRESET 等)：积压的数据和等待发送完成的回调全部作废，回调不执行
+// (例如离线消息只有真正发出去才会删除，这里不能让它以为已经发完了)
+// 再 shutdown 触发 onRead -> read 0 -> closeCallback，和空闲超时一样走统一的关闭流程
+void TcpConnection::handleWriteError(int saveErrno) {
+    std::cout << "TcpConnection 发送数据失败 errno=" << saveErrno << "，断开连接 fd=" << socket_->getFd() << std::endl;
+    disconnected_ = true;
+    flushCallbacks_.clear();
+    writeBuffer_.retrieve(writeBuffer_.readableBytes());
+    shutdown(socket_->getFd(), SHUT_RDWR);
+}
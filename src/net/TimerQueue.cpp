@@ -0,0 +1,109 @@
+#include "net/TimerQueue.h"
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>    // std::push_heap, std::pop_heap
+#include <stdexcept>
+
+TimerQueue::TimerQueue()
+    : timerFd_(::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+{
+    if (timerFd_ == -1) {
+        throw std::runtime_error("timerfd 创建失败！");
+    }
+}
+
+TimerQueue::~TimerQueue() {
+    ::close(timerFd_);
+}
+
+void TimerQueue::addTimer(TimerId id, Clock::time_point when, double interval, TimerCallback cb) {
+    Clock::duration period = Clock::duration::zero();
+    if (interval > 0) {
+        period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+    }
+    timers_[id] = Timer{when, period, std::move(cb)};
+    pushHeap(when, id);
+
+    // 新定时器成了最早到期的那个，需要提前 timerfd
+    if (heap_.front().id == id) {
+        resetTimerfd();
+    }
+}
+
+void TimerQueue::cancel(TimerId id) {
+    // 堆里的条目不动，等它浮到堆顶时再丢掉
+    timers_.erase(id);
+}
+
+bool TimerQueue::isStale(const HeapEntry& entry) const {
+    auto it = timers_.find(entry.id);
+    return it == timers_.end() || it->second.when != entry.when;
+}
+
+void TimerQueue::pushHeap(Clock::time_point when, TimerId id) {
+    heap_.push_back(HeapEntry{when, id});
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+}
+
+void TimerQueue::resetTimerfd() {
+    while (!heap_.empty() && isStale(heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+        heap_.pop_back();
+    }
+
+    struct itimerspec spec = {};
+    if (!heap_.empty()) {
+        auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(heap_.front().when - Clock::now()).count();
+        // it_value 全 0 表示关闭定时器，已经到期的也至少设 1 纳秒让它立刻触发
+        if (delay < 1) {
+            delay = 1;
+        }
+        spec.it_value.tv_sec = static_cast<time_t>(delay / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(delay % 1000000000);
+    }
+    ::timerfd_settime(timerFd_, 0, &spec, nullptr);
+}
+
+void TimerQueue::handleRead() {
+    uint64_t expirations = 0;
+    ::read(timerFd_, &expirations, sizeof(expirations)); // 读空计数，值本身用不到
+
+    Clock::time_point now = Clock::now();
+    while (!heap_.empty() && heap_.front().when <= now) {
+        HeapEntry top = heap_.front();
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+        heap_.pop_back();
+
+        auto it = timers_.find(top.id);
+        if (it == timers_.end() || it->second.when != top.when) {
+            continue; // 已取消或已重新调度
+        }
+
+        if (it->second.interval == Clock::duration::zero()) {
+            // 一次性定时器：先移出再执行，回调里再 cancel 自己也没问题
+            TimerCallback cb = std::move(it->second.cb);
+            timers_.erase(it);
+            cb();
+            continue;
+        }
+
+        // 周期定时器：执行期间把回调拿出来，防止回调里 cancel 自己时把正在执行的函数对象析构掉
+        TimerCallback cb = std::move(it->second.cb);
+        cb();
+
+        it = timers_.find(top.id);
+        if (it == timers_.end()) {
+            continue; // 回调里取消了自己
+        }
+        it->second.cb = std::move(cb);
+        // 按固定节拍推进，不累计误差；loop 被阻塞错过了节拍就从现在重新开始
+        Clock::time_point next = top.when + it->second.interval;
+        if (next <= now) {
+            next = now + it->second.interval;
+        }
+        it->second.when = next;
+        pushHeap(next, top.id);
+    }
+
+    resetTimerfd();
+}
@@ -0,0 +1,100 @@
+#include "net/TimingWheel.h"
+
+TimingWheel::Entry::~Entry() {
+    // 正常情况下连接关闭时已经摘下，这里只是兜底
+    if (wheel_ != nullptr) {
+        wheel_->remove(this);
+    }
+}
+
+TimingWheel::TimingWheel(size_t slots)
+    : slots_(slots == 0 ? 1 : slots, nullptr),
+      currentTick_(0),
+      timeoutTicks_(0)
+{
+}
+
+TimingWheel::~TimingWheel() {
+    // 把还挂着的节点都摘下，避免它们析构时访问已经销毁的时间轮
+    for (Entry* head : slots_) {
+        while (head != nullptr) {
+            Entry* next = head->next_;
+            head->wheel_ = nullptr;
+            head->prev_ = head->next_ = nullptr;
+            head = next;
+        }
+    }
+}
+
+void TimingWheel::link(Entry* entry) {
+    Entry*& head = slots_[entry->expireTick_ % slots_.size()];
+    entry->wheel_ = this;
+    entry->prev_ = nullptr;
+    entry->next_ = head;
+    if (head != nullptr) {
+        head->prev_ = entry;
+    }
+    head = entry;
+}
+
+void TimingWheel::unlink(Entry* entry) {
+    if (entry->prev_ != nullptr) {
+        entry->prev_->next_ = entry->next_;
+    } else {
+        slots_[entry->expireTick_ % slots_.size()] = entry->next_;
+    }
+    if (entry->next_ != nullptr) {
+        entry->next_->prev_ = entry->prev_;
+    }
+    entry->wheel_ = nullptr;
+    entry->prev_ = entry->next_ = nullptr;
+}
+
+void TimingWheel::add(Entry* entry) {
+    if (timeoutTicks_ == 0 || entry->wheel_ != nullptr) {
+        return;
+    }
+    entry->expireTick_ = currentTick_ + timeoutTicks_;
+    link(entry);
+}
+
+void TimingWheel::refresh(Entry* entry) {
+    if (entry->wheel_ != this) {
+        return;
+    }
+    uint64_t expire = currentTick_ + timeoutTicks_;
+    if (expire == entry->expireTick_) {
+        return; // 同一个 tick 内多次活跃，什么都不用做
+    }
+    // 先摘下再按新的到期时间挂回去 (槽号由 expireTick_ 算出，所以必须先 unlink)
+    unlink(entry);
+    entry->expireTick_ = expire;
+    link(entry);
+}
+
+void TimingWheel::remove(Entry* entry) {
+    if (entry->wheel_ == this) {
+        unlink(entry);
+    }
+}
+
+void TimingWheel::tick() {
+    ++currentTick_;
+
+    // 先把到期的节点都摘下来，再统一回调，回调里即使操作时间轮也不会破坏遍历
+    Entry* entry = slots_[currentTick_ % slots_.size()];
+    while (entry != nullptr) {
+        Entry* next = entry->next_;
+        // 超时时间超过一圈的节点还没到期，留在槽里等下一圈
+        if (entry->expireTick_ <= currentTick_) {
+            unlink(entry);
+            expired_.push_back(entry);
+        }
+        entry = next;
+    }
+
+    for (Entry* e : expired_) {
+        e->onExpire();
+    }
+    expired_.clear();
+}
@@ -1,92 +1,132 @@
 #include "server/ChatServer.h"
 #include "server/chatservice.hpp" // [修复] 引入业务类头文件
+#include "db/ConnectionPool.h"
 #include <iostream>
 #include <cstring>
 #include <cerrno>
 #include <functional> // for std::bind
 #include <thread> // [新增]
 #include <unistd.h>
+#include <pthread.h> // pthread_setaffinity_np
+
+// [新增] 运行统计的打印周期 (秒)
+static const double kStatsInterval = 60.0;
+
+ChatServer::ChatServer(int port, int ioThreadNum, bool reusePort)
+    : port_(port),
+      reusePort_(reusePort),
+      cpuAffinity_(false),
+      idleTimeout_(30),
+      dbWorkers_(0)
+{
+    // 1. 初始化主 Reactor 和 Sub Reactor 线程池
+    baseLoop_ = std::make_unique<EventLoop>();
+    ioThreadPool_ = std::make_unique<EventLoopThreadPool>(baseLoop_.get(), ioThreadNum);
+
+    // 2. reusePort 模式下，监听 socket 在 start() 时按 IO 线程分片创建
+    if (!reusePort_) {
+        // 初始化监听 Socket
+        listener_ = std::make_unique<Socket>();
+        listener_->bind("0.0.0.0", port_);
+        listener_->listen();
+        listener_->setNonBlocking(); // Epoll 必须非阻塞
+
+        // 把监听 Socket 加入主 Reactor
+        // EPOLLIN: 读事件, EPOLLET: 边缘触发
+        baseLoop_->registerFd(listener_->getFd(), EPOLLIN | EPOLLET,
+            std::bind(&ChatServer::handleNewConnection, this, listener_.get(), baseLoop_.get()));
+    }
 
-ChatServer::ChatServer(int port) : port_(port) {
-    // 1. 初始化监听 Socket
-    listener_ = std::make_unique<Socket>();
-    listener_->bind("0.0.0.0", port_);
-    listener_->listen();
-    listener_->setNonBlocking(); // Epoll 必须非阻塞
-
-    // 2. 初始化 Epoll
-    epoll_ = std::make_unique<Epoll>();
-    
-    // 3. 把监听 Socket 加入 Epoll
-    // EPOLLIN: 读事件, EPOLLET: 边缘触发
-    epoll_->updateChannel(listener_->getFd(), EPOLL_CTL_ADD, EPOLLIN | EPOLLET);
-
-    std::cout << "ChatServer 初始化完成，监听端口: " << port_ << std::endl;
+    std::cout << "ChatServer 初始化完成，监听端口: " << port_ << " IO线程数: " << ioThreadNum
+              << (reusePort_ ? " (SO_REUSEPORT 分片监听)" : "") << std::endl;
 }
 
 ChatServer::~ChatServer() {
-    // 智能指针会自动释放 Socket 和 Epoll，不需要手动 delete
+    // 智能指针会自动释放 Socket 和 EventLoop，不需要手动 delete
 }
 
 void ChatServer::start() {
     std::cout << "ChatServer 服务已启动..." << std::endl;
 
-    // [新增] 启动后台心跳检测线程
-    std::thread checkThread(std::bind(&ChatServer::checkConnectionTask, this));
-    checkThread.detach();
+    // [新增] 业务线程要在 IO 线程开始派发消息之前就绪
+    ChatService::instance()->startWorkers(dbWorkers_);
 
-    while (true) {
-        // 等待事件
-        auto events = epoll_->poll();
+    // [新增] 登记本节点的在线状态 (租约由 Presence 的续约线程维护，不占用事件循环)
+    if (nodeId_.empty()) {
+        char host[256] = {0};
+        gethostname(host, sizeof(host) - 1);
+        nodeId_ = std::string(host) + ":" + std::to_string(port_);
+    }
+    ChatService::instance()->startPresence(nodeId_);
+
+    // 启动 Sub Reactor 线程
+    if (reusePort_) {
+        // 先在当前线程按顺序创建好所有监听 socket，出错时异常可以正常抛给调用者
+        int ncpu = static_cast<int>(std::thread::hardware_concurrency());
+        for (int i = 0; i < ioThreadPool_->size(); ++i) {
+            auto listener = std::make_unique<Socket>();
+            listener->setReusePort(true);
+            if (cpuAffinity_ && ncpu > 0) {
+                listener->setIncomingCpu(i % ncpu);
+            }
+            listener->bind("0.0.0.0", port_);
+            listener->listen();
+            listener->setNonBlocking();
+            shardListeners_.push_back(std::move(listener));
+        }
+    }
+    // [修改] 空闲超时在每个 loop 线程启动前就配好，不会有连接在配置生效之前被接收
+    ioThreadPool_->start(std::bind(&ChatServer::initIoLoop, this, std::placeholders::_1, std::placeholders::_2));
+
+    // [新增] 数据库连接池的空闲连接回收挂到主 Reactor 的定时器上，不再单独起一个睡眠线程
+    // [修改] 定时器只负责触发，关连接 (mysql_close 要和服务器通信) 交给 DB 通道的线程，不卡住 accept
+    ConnectionPool* pool = ConnectionPool::getInstance();
+    if (pool->getMaxIdleTime() > 0) {
+        baseLoop_->runEvery(pool->getMaxIdleTime(), [pool]() {
+            ChatService::instance()->runOnDbLane([pool]() { pool->scanIdleConnections(); });
+        });
+    }
 
+    // [新增] 周期打印运行统计 (缓存命中率等)
+    baseLoop_->runEvery(kStatsInterval, []() { ChatService::instance()->logStats(); });
 
-        for (auto& event : events) {
-            int fd = event.data.fd;
+    // 主 Reactor 在当前线程运行
+    baseLoop_->loop();
+}
 
-            // 情况 A: 监听 Socket 有动静 -> 新用户连接
-            if (fd == listener_->getFd()) {
-                handleNewConnection();
-            }
-            else {
-                // [加锁] 保护 connections_ 的读取
-                TcpConnection::ptr conn = nullptr;
-                {
-                    std::lock_guard<std::mutex> lock(connMutex_);
-                    auto it = connections_.find(fd);
-                    if (it != connections_.end()) {
-                        conn = it->second;
-                    }
-                }
-
-                if (!conn) {
-                    epoll_->updateChannel(fd, EPOLL_CTL_DEL, 0);
-                    close(fd);
-                    continue;
-                }
-
-                // 优先处理异常/对端半关闭事件
-                if (event.events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
-                    conn->onRead();
-                    continue;
-                }
-
-                if (event.events & EPOLLIN) {
-                    conn->onRead();
-                }
-
-                if (event.events & EPOLLOUT) {
-                    conn->onWrite();
-                }
-            }
-        }
+// [新增] 在 loop 线程里、事件循环开始之前执行
+void ChatServer::initIoLoop(EventLoop* loop, int index) {
+    // 心跳检测：每个 loop 用自己的时间轮踢掉空闲连接，不再需要单独的扫描线程
+    // loop 还没开始运行，这里就是它的线程，可以直接配置时间轮
+    loop->getIdleWheel().setTimeout(idleTimeout_ > 0 ? static_cast<uint64_t>(idleTimeout_) : 0);
+
+    if (reusePort_) {
+        initShardLoop(loop, index);
     }
 }
 
-void ChatServer::handleNewConnection() {
+void ChatServer::initShardLoop(EventLoop* loop, int index) {
+    Socket* listener = shardListeners_[index].get();
+
+    // 绑定 CPU，配合监听 socket 上的 SO_INCOMING_CPU，连接从网卡中断到业务处理都在同一个核上
+    int ncpu = static_cast<int>(std::thread::hardware_concurrency());
+    if (cpuAffinity_ && ncpu > 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(index % ncpu, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+    }
+
+    // 本线程的监听 socket 只注册在本线程的 loop 上
+    loop->registerFd(listener->getFd(), EPOLLIN | EPOLLET,
+        std::bind(&ChatServer::handleNewConnection, this, listener, loop));
+}
+
+void ChatServer::handleNewConnection(Socket* listener, EventLoop* acceptLoop) {
     // ET 模式下必须把 accept 队列“读空”，直到 EAGAIN/EWOULDBLOCK
     while (true) {
         struct sockaddr_in addr;
-        int clnt_fd = listener_->accept(&addr);
+        int clnt_fd = listener->accept(&addr);
 
         if (clnt_fd == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -99,37 +139,26 @@ void ChatServer::handleNewConnection() {
             break;
         }
 
+        // reusePort 模式：谁 accept 谁负责，没有跨线程转交
+        // 否则：轮询选出一个 Sub Reactor，连接以后的读写都交给它
+        EventLoop* ioLoop = reusePort_ ? acceptLoop : ioThreadPool_->getNextLoop();
+
         // 创建连接对象
-        auto conn = std::make_shared<TcpConnection>(epoll_.get(), clnt_fd);
+        auto conn = std::make_shared<TcpConnection>(ioLoop, clnt_fd);
 
         // [关键] 设置关闭回调
         // 当 TcpConnection 发现客户端断开时，会调用 ChatServer::handleClientDisconnect
-        conn->setCloseCallback(std::bind(&ChatServer::handleClientDisconnect, this, std::placeholders::_1));
-
-        // 存入 map
-        {
-            std::lock_guard<std::mutex> lock(connMutex_);
-            connections_[clnt_fd] = conn;
-        }
+        conn->setCloseCallback(std::bind(&ChatServer::handleClientDisconnect, this, ioLoop, std::placeholders::_1));
 
-        // 加入 Epoll
-        epoll_->updateChannel(clnt_fd, EPOLL_CTL_ADD, EPOLLIN | EPOLLET | EPOLLRDHUP);
+        // 存入 Sub Reactor 的连接表并加入它的 Epoll
+        ioLoop->addConnection(conn);
 
-        std::cout << "新连接建立 fd=" << clnt_fd << " 当前在线(Roughly): " << connections_.size() << std::endl;
+        std::cout << "新连接建立 fd=" << clnt_fd << " 当前loop在线(Roughly): " << ioLoop->connectionCount() << std::endl;
     }
 }
 
-void ChatServer::handleClientDisconnect(int fd) {
-    TcpConnection::ptr conn = nullptr;
-    
-    {
-        std::lock_guard<std::mutex> lock(connMutex_);
-        auto it = connections_.find(fd);
-        if (it != connections_.end()) {
-            conn = it->second;
-            connections_.erase(it);
-        }
-    }
+void ChatServer::handleClientDisconnect(EventLoop* loop, int fd) {
+    TcpConnection::ptr conn = loop->removeConnection(fd);
     
     // [新增] 通知业务层处理客户端异常退出 (比如把用户状态改为 offline)
     // 这里需要 ChatService 提供一个处理客户端异常退出的接口
@@ -137,35 +166,5 @@ void ChatServer::handleClientDisconnect(int fd) {
         ChatService::instance()->clientCloseException(conn);
     }
 
-    std::cout << "客户端断开，已回收资源 fd=" << fd << " 当前在线: " << connections_.size() << std::endl;
-}
-// 定时任务：扫描所有超时连接并断开
-void ChatServer::checkConnectionTask() {
-    while (true) {
-        // 每 5 秒检查一次
-        sleep(5);
-        
-        time_t now = time(nullptr);
-        
-        // [加锁保护] - 这里的逻辑略复杂，因为我们不想一直长时间持有锁
-        // 方案：快速拷贝所有 snapshot，或者就在得锁期间处理
-        // 考虑到 demo，直接加锁遍历
-        std::vector<int> timeout_fds;
-        
-        {
-            std::lock_guard<std::mutex> lock(connMutex_);
-            for (auto it = connections_.begin(); it != connections_.end(); ++it) {
-                TcpConnection::ptr conn = it->second;
-                if (now - conn->getAliveTime() > 30) {
-                    timeout_fds.push_back(it->first);
-                }
-            }
-        } // 释放锁
-        
-        for (int fd : timeout_fds) {
-             std::cout << "[Heartbeat] Connection timeout fd=" << fd << ", kicking out..." << std::endl;
-             // shutdown 会触发主 loop 的 onRead -> read 0 -> handleClientDisconnect
-             shutdown(fd, SHUT_RDWR);
-        }
-    }
+    std::cout << "客户端断开，已回收资源 fd=" << fd << " 当前loop在线: " << loop->connectionCount() << std::endl;
 }
@@ -0,0 +1,423 @@
+#include "server/Presence.hpp"
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+
+namespace {
+
+const char* kPresenceKey = "presence";
+const char* kNodesKey = "presence:nodes";
+const char* kChannel = "presence";
+
+// 上线：用户已经在另一个租约还有效的节点上就拒绝，否则改成本节点并发布变更
+// KEYS[1]=presence ARGV[1]=userid ARGV[2]=本节点
+const char* kOnlineScript =
+    "local cur = redis.call('HGET', KEYS[1], ARGV[1]) "
+    "if cur and cur ~= ARGV[2] and redis.call('EXISTS', 'presence:node:' .. cur) == 1 then return 0 end "
+    "if cur and cur ~= ARGV[2] then redis.call('SREM', 'presence:users:' .. cur, ARGV[1]) end "
+    "redis.call('HSET', KEYS[1], ARGV[1], ARGV[2]) "
+    "redis.call('SADD', 'presence:users:' .. ARGV[2], ARGV[1]) "
+    "redis.call('PUBLISH', 'presence', '+' .. ARGV[1] .. ' ' .. ARGV[2]) "
+    "return 1";
+
+// 下线：只有记录仍然指向本节点时才删除
+const char* kOfflineScript =
+    "redis.call('SREM', 'presence:users:' .. ARGV[2], ARGV[1]) "
+    "if redis.call('HGET', KEYS[1], ARGV[1]) ~= ARGV[2] then return 0 end "
+    "redis.call('HDEL', KEYS[1], ARGV[1]) "
+    "redis.call('PUBLISH', 'presence', '-' .. ARGV[1] .. ' ' .. ARGV[2]) "
+    "return 1";
+
+// 清理节点：把它名下仍然指向它的用户全部删除，再注销这个节点
+// KEYS[1]=presence ARGV[1]=节点
+const char* kCleanupScript =
+    "local users = redis.call('SMEMBERS', 'presence:users:' .. ARGV[1]) "
+    "for _, uid in ipairs(users) do "
+    "  if redis.call('HGET', KEYS[1], uid) == ARGV[1] then "
+    "    redis.call('HDEL', KEYS[1], uid) "
+    "    redis.call('PUBLISH', 'presence', '-' .. uid .. ' ' .. ARGV[1]) "
+    "  end "
+    "end "
+    "redis.call('DEL', 'presence:users:' .. ARGV[1]) "
+    "redis.call('SREM', 'presence:nodes', ARGV[1]) "
+    "return #users";
+
+// [新增] 连接 Redis，失败返回 nullptr
+redisContext* connectRedis() {
+    redisContext* context = redisConnect("127.0.0.1", 6379);
+    if (context != nullptr && context->err) {
+        redisFree(context);
+        context = nullptr;
+    }
+    return context;
+}
+
+// [新增] 执行一条命令并打印错误，返回的 reply 由调用者释放
+redisReply* vcommand(redisContext* context, const char* format, va_list ap) {
+    redisReply* reply = static_cast<redisReply*>(redisvCommand(context, format, ap));
+    if (reply == nullptr) {
+        std::cerr << "presence command failed!" << std::endl;
+    } else if (reply->type == REDIS_REPLY_ERROR) {
+        std::cerr << "presence command error: " << reply->str << std::endl;
+    }
+    return reply;
+}
+
+} // namespace
+
+Presence::Presence() : clustered_(false), cmdContext_(nullptr), subContext_(nullptr), hbContext_(nullptr), stop_(false) {
+}
+
+Presence::~Presence() {
+    // 先停续约线程，它还在用 hbContext_
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        stop_ = true;
+    }
+    stopCv_.notify_one();
+    if (heartbeatThread_.joinable()) {
+        heartbeatThread_.join();
+    }
+
+    if (cmdContext_ != nullptr) {
+        redisFree(cmdContext_);
+    }
+    if (subContext_ != nullptr) {
+        redisFree(subContext_);
+    }
+    if (hbContext_ != nullptr) {
+        redisFree(hbContext_);
+    }
+}
+
+bool Presence::start(const std::string& nodeId) {
+    nodeId_ = nodeId;
+
+    cmdContext_ = connectRedis();
+    hbContext_ = connectRedis();
+    // [修改] 订阅失败也和连接失败一样，三条连接都释放掉，退化为单机模式
+    if (cmdContext_ == nullptr || hbContext_ == nullptr || !subscribe()) {
+        std::cerr << "presence: connect redis failed, 退化为单机模式" << std::endl;
+        for (redisContext** context : {&cmdContext_, &subContext_, &hbContext_}) {
+            if (*context != nullptr) {
+                redisFree(*context);
+                *context = nullptr;
+            }
+        }
+        return false;
+    }
+
+    // 1. 先订阅变更再加载全表，加载期间发生的变更不会漏掉 (重复应用是幂等的)
+    //    加载完成之前订阅线程还没启动，变更先留在 socket 里
+    // 2. 同名节点上次遗留的记录 (崩溃后重启) 作废，然后登记租约
+    cleanupNode(nodeId_);
+    heartbeat();
+
+    // 3. 加载当前的在线表
+    resync();
+    clustered_ = true;
+
+    std::thread t([this]() { observe(); });
+    t.detach();
+    // [修改] 续约放在自己的线程上，不再挂到事件循环的定时器上
+    heartbeatThread_ = std::thread(&Presence::heartbeatLoop, this);
+
+    std::cout << "presence 节点: " << nodeId_ << std::endl;
+    return true;
+}
+
+bool Presence::online(int userid) {
+    if (clustered_) {
+        redisReply* reply = command("EVAL %s 1 %s %d %s", kOnlineScript, kPresenceKey, userid, nodeId_.c_str());
+        // Redis 出错时只记在本机，不因为它拒绝登录 (这段时间里跨节点的重复登录检查不到)
+        if (reply != nullptr) {
+            bool duplicate = reply->type == REDIS_REPLY_INTEGER && reply->integer == 0;
+            freeReplyObject(reply);
+            if (duplicate) {
+                return false;
+            }
+        }
+    }
+    mirrorSet(userid, nodeId_);
+    return true;
+}
+
+void Presence::offline(int userid) {
+    mirrorErase(userid, nodeId_);
+    if (clustered_) {
+        redisReply* reply = command("EVAL %s 1 %s %d %s", kOfflineScript, kPresenceKey, userid, nodeId_.c_str());
+        if (reply != nullptr) {
+            freeReplyObject(reply);
+        }
+    }
+}
+
+std::string Presence::locate(int userid) const {
+    const Shard& shard = shardOf(userid);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.nodes.find(userid);
+    return it != shard.nodes.end() ? it->second : std::string();
+}
+
+void Presence::heartbeatLoop() {
+    std::unique_lock<std::mutex> lock(stopMutex_);
+    auto interval = std::chrono::duration<double>(kHeartbeatInterval);
+    while (!stopCv_.wait_for(lock, interval, [this]() { return stop_; })) {
+        lock.unlock();
+        heartbeat();
+        lock.lock();
+    }
+}
+
+void Presence::heartbeat() {
+    // [新增] 续约连接断了先重连，连不上就等下一轮 (租约比续约周期长，错过一两次不会被判定失效)
+    if (hbContext_ != nullptr && hbContext_->err) {
+        std::cerr << "presence: 续约连接断开，重连" << std::endl;
+        redisFree(hbContext_);
+        hbContext_ = nullptr;
+    }
+    if (hbContext_ == nullptr) {
+        hbContext_ = connectRedis();
+        if (hbContext_ == nullptr) {
+            return;
+        }
+    }
+
+    // 1. 续约本节点
+    // [修改] 先 EXPIRE：返回 0 说明租约已经不在了 (续约中断太久被别的节点清理，或者 Redis 重启 / 被清空)，
+    //        本节点的在线记录可能已经没了，重新登记租约后要把本机用户写回去
+    redisReply* reply = heartbeatCommand("EXPIRE presence:node:%s %d", nodeId_.c_str(), kLeaseSeconds);
+    bool lapsed = reply != nullptr && reply->type == REDIS_REPLY_INTEGER && reply->integer == 0;
+    if (reply != nullptr) {
+        freeReplyObject(reply);
+    }
+    if (lapsed) {
+        reply = heartbeatCommand("SET presence:node:%s 1 EX %d", nodeId_.c_str(), kLeaseSeconds);
+        if (reply != nullptr) {
+            freeReplyObject(reply);
+        }
+    }
+    reply = heartbeatCommand("SADD %s %s", kNodesKey, nodeId_.c_str());
+    if (reply != nullptr) {
+        freeReplyObject(reply);
+    }
+
+    // 2. 检查其他节点的租约，过期的说明节点已经不在了，替它清理
+    std::vector<std::string> nodes;
+    reply = heartbeatCommand("SMEMBERS %s", kNodesKey);
+    if (reply != nullptr && reply->type == REDIS_REPLY_ARRAY) {
+        for (size_t i = 0; i < reply->elements; ++i) {
+            nodes.emplace_back(reply->element[i]->str, reply->element[i]->len);
+        }
+    }
+    if (reply != nullptr) {
+        freeReplyObject(reply);
+    }
+
+    for (const std::string& node : nodes) {
+        if (node == nodeId_) {
+            continue;
+        }
+        reply = heartbeatCommand("EXISTS presence:node:%s", node.c_str());
+        bool alive = reply != nullptr && reply->type == REDIS_REPLY_INTEGER && reply->integer == 1;
+        if (reply != nullptr) {
+            freeReplyObject(reply);
+        }
+        if (!alive) {
+            std::cout << "presence: 节点 " << node << " 租约过期，清理其在线用户" << std::endl;
+            cleanupNode(node);
+        }
+    }
+
+    // 3. [新增] 租约断过：本机用户写回 Redis (启动时本机还没有用户，什么也不做)
+    if (lapsed && clustered_) {
+        std::cerr << "presence: 本节点租约曾经过期，重新登记本机在线用户" << std::endl;
+        restoreLocalUsers();
+    }
+}
+
+void Presence::restoreLocalUsers() {
+    std::vector<int> users;
+    for (Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto& entry : shard.nodes) {
+            if (entry.second == nodeId_) {
+                users.push_back(entry.first);
+            }
+        }
+    }
+
+    for (int userid : users) {
+        redisReply* reply = command("EVAL %s 1 %s %d %s", kOnlineScript, kPresenceKey, userid, nodeId_.c_str());
+        if (reply != nullptr) {
+            if (reply->type == REDIS_REPLY_INTEGER && reply->integer == 0) {
+                std::cerr << "presence: 用户 " << userid << " 已经在别的节点上登录" << std::endl;
+            }
+            freeReplyObject(reply);
+        }
+        // 写回期间用户下线了：offline 的删除可能排在上面的写入之前，这里再删一次，不留下过期的记录
+        if (locate(userid) != nodeId_) {
+            reply = command("EVAL %s 1 %s %d %s", kOfflineScript, kPresenceKey, userid, nodeId_.c_str());
+            if (reply != nullptr) {
+                freeReplyObject(reply);
+            }
+        }
+    }
+}
+
+void Presence::cleanupNode(const std::string& node) {
+    redisReply* reply = heartbeatCommand("EVAL %s 1 %s %s", kCleanupScript, kPresenceKey, node.c_str());
+    if (reply != nullptr) {
+        freeReplyObject(reply);
+    }
+}
+
+redisReply* Presence::command(const char* format, ...) {
+    std::lock_guard<std::mutex> lock(cmdMutex_);
+    // [修改] 连接出过错就重连，失败的命令在新连接上再执行一次 (这里的命令都是幂等的)
+    redisReply* reply = nullptr;
+    for (int attempt = 0; attempt < 2 && reply == nullptr; ++attempt) {
+        if (cmdContext_ != nullptr && cmdContext_->err) {
+            std::cerr << "presence: 命令连接断开，重连" << std::endl;
+            redisFree(cmdContext_);
+            cmdContext_ = nullptr;
+        }
+        if (cmdContext_ == nullptr) {
+            cmdContext_ = connectRedis();
+            if (cmdContext_ == nullptr) {
+                return nullptr;
+            }
+        }
+        va_list ap;
+        va_start(ap, format);
+        reply = vcommand(cmdContext_, format, ap);
+        va_end(ap);
+    }
+    return reply;
+}
+
+redisReply* Presence::heartbeatCommand(const char* format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    redisReply* reply = vcommand(hbContext_, format, ap);
+    va_end(ap);
+    return reply;
+}
+
+bool Presence::subscribe() {
+    if (subContext_ != nullptr) {
+        redisFree(subContext_);
+    }
+    subContext_ = connectRedis();
+    if (subContext_ == nullptr) {
+        return false;
+    }
+    redisReply* reply = static_cast<redisReply*>(redisCommand(subContext_, "SUBSCRIBE %s", kChannel));
+    if (reply == nullptr) {
+        std::cerr << "presence: subscribe failed!" << std::endl;
+        return false;
+    }
+    freeReplyObject(reply);
+    return true;
+}
+
+void Presence::resync() {
+    std::unordered_map<int, std::string> snapshot;
+    redisReply* reply = command("HGETALL %s", kPresenceKey);
+    if (reply == nullptr || reply->type != REDIS_REPLY_ARRAY) {
+        if (reply != nullptr) {
+            freeReplyObject(reply);
+        }
+        return; // 加载失败时保留现有镜像，不把所有人都当成离线
+    }
+    for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+        snapshot[atoi(reply->element[i]->str)] = std::string(reply->element[i + 1]->str, reply->element[i + 1]->len);
+    }
+    freeReplyObject(reply);
+
+    // 本节点的用户以本地为准 (online/offline 直接改镜像)，其他节点的以 Redis 为准
+    for (Shard& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto it = shard.nodes.begin(); it != shard.nodes.end();) {
+            if (it->second != nodeId_ && snapshot.find(it->first) == snapshot.end()) {
+                it = shard.nodes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& entry : snapshot) {
+        if (entry.second == nodeId_) {
+            continue;
+        }
+        Shard& shard = shardOf(entry.first);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.nodes.find(entry.first);
+        if (it == shard.nodes.end() || it->second != nodeId_) {
+            shard.nodes[entry.first] = entry.second;
+        }
+    }
+}
+
+void Presence::observe() {
+    for (;;) {
+        redisReply* reply = nullptr;
+        while (REDIS_OK == redisGetReply(subContext_, (void**)&reply)) {
+            // 订阅收到的消息是一个三元素数组: "message", 通道, 内容
+            if (reply != nullptr && reply->type == REDIS_REPLY_ARRAY && reply->elements == 3
+                && reply->element[2]->str != nullptr && strcmp(reply->element[0]->str, "message") == 0) {
+                applyEvent(reply->element[2]->str);
+            }
+            freeReplyObject(reply);
+        }
+
+        // [新增] 订阅连接断了：断开期间的变更都收不到，重连后先订阅再重新加载全表
+        std::cerr << ">>>>>>>>>>>>> presence 订阅连接断开，正在重连 <<<<<<<<<<<<<" << std::endl;
+        while (!subscribe()) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(kReconnectDelay));
+        }
+        resync();
+        // [新增] 断开的可能是 Redis 本身 (重启 / 清空)，本机用户的记录要写回去，其他节点才找得到他们
+        restoreLocalUsers();
+        std::cout << "presence 订阅已恢复" << std::endl;
+    }
+}
+
+void Presence::applyEvent(const char* event) {
+    const char* space = strchr(event, ' ');
+    if ((event[0] != '+' && event[0] != '-') || space == nullptr) {
+        return;
+    }
+    int userid = atoi(event + 1);
+    std::string node(space + 1);
+
+    // 本节点的变化在 online/offline 里已经直接改过镜像，回显的事件可能和后续操作乱序，忽略
+    if (node == nodeId_) {
+        return;
+    }
+    if (event[0] == '+') {
+        mirrorSet(userid, node);
+    } else {
+        mirrorErase(userid, node);
+    }
+}
+
+void Presence::mirrorSet(int userid, const std::string& node) {
+    Shard& shard = shardOf(userid);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.nodes[userid] = node;
+}
+
+void Presence::mirrorErase(int userid, const std::string& node) {
+    Shard& shard = shardOf(userid);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.nodes.find(userid);
+    if (it != shard.nodes.end() && it->second == node) {
+        shard.nodes.erase(it);
+    }
+}
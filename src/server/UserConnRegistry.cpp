@@ -0,0 +1,35 @@
+#include "server/UserConnRegistry.hpp"
+#include <mutex>
+
+bool UserConnRegistry::insert(int userid, const std::shared_ptr<TcpConnection>& conn) {
+    Shard& shard = shardOf(userid);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (!shard.conns.emplace(userid, conn).second) {
+        return false;
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::shared_ptr<TcpConnection> UserConnRegistry::find(int userid) const {
+    const Shard& shard = shardOf(userid);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.conns.find(userid);
+    return it != shard.conns.end() ? it->second : nullptr;
+}
+
+bool UserConnRegistry::erase(int userid, const TcpConnection* conn) {
+    Shard& shard = shardOf(userid);
+    std::shared_ptr<TcpConnection> removed; // 在锁外析构，连接可能在这里被最终释放
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.conns.find(userid);
+        if (it == shard.conns.end() || it->second.get() != conn) {
+            return false;
+        }
+        removed = std::move(it->second);
+        shard.conns.erase(it);
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
@@ -2,6 +2,9 @@
 #include "public.hpp"
 #include "msg.pb.h"
 #include <iostream>
+#include <thread>
+#include <algorithm>
+#include <array>
 
 using namespace std;
 using namespace chat; // protobuf 命名空间
@@ -11,29 +14,53 @@ ChatService* ChatService::instance() {
     return &service;
 }
 
-// 注册消息以及对应的Handler回调操作
-ChatService::ChatService() {
-    // 启动线程池 (例如 4 个 worker 线程)
-    // 根据机器 CPU 核心数或者业务负载调整，这里默认给 4 个
-    _threadPool = std::make_unique<ThreadPool>(4);
+namespace {
+
+// [修改] 注册消息以及对应的Handler回调操作
+// 消息 id 是 public.hpp 里从 1 开始的连续枚举，直接用它做下标；没有登记的 id 对应 method 为空
+constexpr std::array<ChatService::HandlerDesc, MSG_TYPE_COUNT> makeHandlerTable() {
+    std::array<ChatService::HandlerDesc, MSG_TYPE_COUNT> table{};
 
     // 用户注册业务管理
-    // 当收到 REG_MSG (注册) 消息时，绑定到 ChatService::reg 方法
-    _msgHandlerMap.insert({REG_MSG, std::bind(&ChatService::reg, this, std::placeholders::_1, std::placeholders::_2)});
-    
+    // 当收到 REG_MSG (注册) 消息时，交给 ChatService::reg 方法 (要写库，走 DB 通道)
+    table[REG_MSG] = {&ChatService::reg, Lane::DB};
+
     // 用户登录业务管理
-    // 当收到 LOGIN_MSG (登录) 消息时，绑定到 ChatService::login 方法
-    _msgHandlerMap.insert({LOGIN_MSG, std::bind(&ChatService::login, this, std::placeholders::_1, std::placeholders::_2)});
+    // 当收到 LOGIN_MSG (登录) 消息时，交给 ChatService::login 方法 (要查库，走 DB 通道)
+    table[LOGIN_MSG] = {&ChatService::login, Lane::DB};
 
     // 一对一聊天业务管理
-    _msgHandlerMap.insert({ONE_CHAT_MSG, std::bind(&ChatService::oneChat, this, std::placeholders::_1, std::placeholders::_2)});
+    // 在线转发只查内存，直接在 IO 线程上完成；对方不在本机时再转到 DB 通道 (见 forwardOrStore)
+    // 注意两条路径不保证相互的顺序，见 oneChat
+    table[ONE_CHAT_MSG] = {&ChatService::oneChat, Lane::INLINE};
+
+    // [新增] 注册心跳消息处理 (空操作，在 IO 线程上直接执行，不值得跨一次线程)
+    table[HEART_BEAT_MSG] = {&ChatService::clientHeartBeat, Lane::INLINE};
+
+    return table;
+}
+
+constexpr auto kHandlerTable = makeHandlerTable();
 
-    // [新增] 注册心跳消息处理
-    _msgHandlerMap.insert({HEART_BEAT_MSG, std::bind(&ChatService::clientHeartBeat, this, std::placeholders::_1, std::placeholders::_2)});
+// [新增] 节点的消息通道名 (每个节点订阅一个，代替每个用户一个通道)
+std::string nodeChannel(const std::string& nodeId) {
+    return "chat:node:" + nodeId;
+}
+
+// [新增] 离线消息每页的条数：登录时内存里最多只有一页
+constexpr size_t kOfflinePageSize = 100;
 
-    // [新增] 只有在构造时重置一次所有用户状态为 offline
-    // 防止服务器崩溃重启后，状态仍为 online 导致无法登录
-    _userModel.resetState();
+} // namespace
+
+ChatService::ChatService() {
+    // [修改] 不再在启动时把 User 表的状态全部重置为 offline：在线状态由 Presence 维护，
+    // 本节点上次遗留的在线记录在 startPresence 时清理，别的节点崩溃则靠租约过期自愈
+
+    // [新增] 离线消息表从 Hex 文本迁移到 BLOB (只在第一次以新版本启动时真正执行)
+    _offlineMsgModel.migrate();
+
+    // [新增] 跨节点消息发出去了但目标节点没有订阅 (节点挂了，在线表还没更新)，转存离线消息
+    _redis.init_undelivered_handler(std::bind(&ChatService::handleRedisUndelivered, this, std::placeholders::_1, std::placeholders::_2));
 
     // 连接 Redis
     if (_redis.connect()) {
@@ -42,36 +69,75 @@ ChatService::ChatService() {
     }
 }
 
-// 获取消息对应的处理器
-MsgHandler ChatService::getHandler(int msgid) {
-    auto it = _msgHandlerMap.find(msgid);
-    if (it == _msgHandlerMap.end()) {
-        // 返回一个默认的空处理器，防止崩溃，并打印错误日志
-        return [=](const std::shared_ptr<TcpConnection>& conn, std::string& data) {
-            cout << "msgid:" << msgid << " can not find handler!" << endl;
-        };
-    } else {
-        // [新增] 异步解耦核心：
-        // 返回一个 Lambda，这个 Lambda 并不直接执行业务，而是把任务提交到 ThreadPool
-        return [this, it](const std::shared_ptr<TcpConnection>& conn, std::string data) {
-            // 将 (handler, conn, data) 投递给线程池
-            _threadPool->enqueue([=]() {
-                // 这个 lambda 会在子线程中执行 -> 真正的业务逻辑
-                // 注意 data 是按值捕获的，虽然有一次拷贝，但保证了数据在子线程有效
-                // conn 是 shared_ptr，安全
-                // it->second 就是真正的 login/reg/chat 方法
-                std::string d = data; // 只是为了解 const
-                it->second(conn, d);
-            });
-        };
+// [新增] 登记本节点并开始维护在线状态 (续约由 Presence 自己的线程负责)
+void ChatService::startPresence(const std::string& nodeId) {
+    // [新增] 发给本节点用户的跨节点消息都从这一个通道进来
+    _redis.subscribe(nodeChannel(nodeId));
+
+    _presence.start(nodeId);
+}
+
+// [新增] 创建工作线程
+void ChatService::startWorkers(size_t dbThreads) {
+    size_t ncpu = std::max(1u, std::thread::hardware_concurrency());
+    // DB 通道的线程大部分时间在等 MySQL 返回，多开一些才能让更多查询同时在路上
+    if (dbThreads == 0) dbThreads = ncpu * 2;
+
+    _dbPool = std::make_unique<ThreadPool>(dbThreads);
+    // [新增] strand 数量远多于 worker 数，不同连接很少会挤在同一个 strand 上互相排队
+    _dbStrands = std::make_unique<StrandGroup>(*_dbPool, 256);
+
+    cout << "ChatService 工作线程: DB " << dbThreads << endl;
+}
+
+// [新增] 打印运行统计
+void ChatService::logStats() {
+    const UserCache& cache = _userModel.cache();
+    unsigned long long hits = cache.hits();
+    unsigned long long misses = cache.misses();
+    unsigned long long total = hits + misses;
+    cout << "[统计] 用户缓存 命中: " << hits << " 未命中: " << misses
+         << " 命中率: " << (total == 0 ? 0 : hits * 100 / total) << "%" << endl;
+}
+
+// [新增] 投递到 DB 通道的线程池
+void ChatService::runOnDbLane(std::function<void()> task) {
+    _dbPool->post(std::move(task));
+}
+
+// [修改] 分发消息
+void ChatService::dispatch(int msgid, const std::shared_ptr<TcpConnection>& conn, std::string_view data) {
+    if (msgid <= 0 || msgid >= MSG_TYPE_COUNT || kHandlerTable[msgid].method == nullptr) {
+        // 没有登记的消息，打印错误日志后丢弃
+        cout << "msgid:" << msgid << " can not find handler!" << endl;
+        return;
+    }
+
+    const HandlerDesc* desc = &kHandlerTable[msgid];
+    if (desc->lane == Lane::INLINE) {
+        // [新增] 轻量处理器直接在 IO 线程上执行，data 视图在调用期间有效，不需要拷贝
+        (this->*desc->method)(conn, data);
+        return;
     }
+
+    // [新增] 异步解耦核心：不直接执行业务，而是把任务提交到工作线程
+    // data 是读缓冲区上的视图，IO 线程返回后就会被覆盖，这里是整条链路上唯一的一次拷贝，
+    // 之后拷贝出来的 string 只做移动，子线程里再以视图的形式交给业务方法
+    // [修改] 用 post 而不是 enqueue：业务方法没有返回值，不需要 future/packaged_task
+    // [修改] 经过连接对应的 strand 投递：同一连接的消息串行、保序，不同连接之间仍然并行
+    _dbStrands->get(conn->getFd()).post([this, desc, conn, d = std::string(data)]() {
+        // 这个 lambda 会在子线程中执行 -> 真正的业务逻辑
+        // conn 是 shared_ptr，安全
+        // desc->method 就是真正的 login/reg 方法
+        (this->*desc->method)(conn, d);
+    });
 }
 
 // 处理注册业务
-void ChatService::reg(const std::shared_ptr<TcpConnection>& conn, std::string& data) {
+void ChatService::reg(const std::shared_ptr<TcpConnection>& conn, std::string_view data) {
     RegRequest req;
     // 1. 反序列化: 把网络层传来的 string 数据转成 RegRequest 对象
-    if (req.ParseFromString(data)) {
+    if (req.ParseFromArray(data.data(), static_cast<int>(data.size()))) {
         string name = req.username();
         string pwd = req.password();
 
@@ -101,14 +167,14 @@ void ChatService::reg(const std::shared_ptr<TcpConnection>& conn, std::string& d
         string send_str;
         resp.SerializeToString(&send_str);
         
-        conn->send(REG_MSG_ACK, send_str);
+        conn->send(REG_MSG_ACK, std::move(send_str));
     }
 }
 
 // 处理登录业务
-void ChatService::login(const std::shared_ptr<TcpConnection>& conn, std::string& data) {
+void ChatService::login(const std::shared_ptr<TcpConnection>& conn, std::string_view data) {
     LoginRequest req;
-    if (req.ParseFromString(data)) {
+    if (req.ParseFromArray(data.data(), static_cast<int>(data.size()))) {
         int id = 0;
         string pwd = req.password();
         // 兼容 username 字段存放 id（简化设计，或者你需要完善协议增加 id 字段）
@@ -136,23 +202,22 @@ void ChatService::login(const std::shared_ptr<TcpConnection>& conn, std::string&
 
         if (user.getId() == id && user.getPwd() == pwd) {
             // 登录成功
-            if (user.getState() == "online") {
+            // 1. 记录用户连接 (本机已有该用户的连接时登记失败，同样视为重复登录)
+            // [修改] 2. 在 Presence 里登记 用户 -> 本节点 (用户在别的存活节点上时失败)，不再写 User.state
+            bool registered = _userConns.insert(id, conn);
+            if (registered && !_presence.online(id)) {
+                _userConns.erase(id, conn.get());
+                registered = false;
+            }
+
+            if (!registered) {
                 // 用户已经在线，不允许重复登录
                 resp.set_success(false);
                 resp.set_msg("该账号已在线，请勿重复登录");
             } else {
-                // 1. 记录用户连接
-                {
-                    lock_guard<mutex> lock(_connMutex);
-                    _userConnMap.insert({id, conn});
-                }
-                
-                // [新增] 登录成功后，向 Redis 订阅该用户的 Channel
-                _redis.subscribe(id);
-
-                // 2. 更新数据库状态为 online
-                user.setState("online");
-                _userModel.updateState(user);
+                // [新增] 连接上记下用户 id，断开时直接定位
+                // [修改] 不再为每个用户订阅一个 Redis 通道，发给本节点的消息都走节点通道
+                conn->setUserId(id);
 
                 // 3. 返回成功
                 resp.set_success(true);
@@ -166,100 +231,135 @@ void ChatService::login(const std::shared_ptr<TcpConnection>& conn, std::string&
         }
         
         resp.SerializeToString(&send_str);
-        conn->send(LOGIN_MSG_ACK, send_str);
+        conn->send(LOGIN_MSG_ACK, std::move(send_str));
 
         // 4. 如果登录成功，再推送离线消息
+        // [修改] 分页推送，一页发出去之后再取下一页，积压再多也不会一次全读进内存
         if (resp.success()) {
-            vector<string> vec = _offlineMsgModel.query(id);
-            if (!vec.empty()) {
-                for (const string& msg : vec) {
-                    conn->send(ONE_CHAT_MSG, msg);
-                }
-                _offlineMsgModel.remove(id);
-            }
+            deliverOffline(conn, id, 0);
         }
     }
 }
 
+// [新增] 推送一页离线消息 (在 DB 通道执行)
+void ChatService::deliverOffline(const std::shared_ptr<TcpConnection>& conn, int userid, long long afterId) {
+    vector<OfflineMsg> page = _offlineMsgModel.query(userid, afterId, kOfflinePageSize);
+    if (page.empty()) {
+        return;
+    }
+
+    long long lastId = page.back().id;
+    bool more = page.size() == kOfflinePageSize;
+    for (OfflineMsg& m : page) {
+        conn->send(ONE_CHAT_MSG, std::move(m.msg));
+    }
+
+    // 这一页真正交给内核之后，才删除已发出的部分并取下一页：
+    // 客户端收得慢时不会继续往发送缓冲区里堆，中途断线的话没发出去的下次登录还在
+    // 回调挂在连接上，只持有弱引用，避免循环引用
+    std::weak_ptr<TcpConnection> weak = conn;
+    conn->runAfterFlush([this, weak, userid, lastId, more]() {
+        std::shared_ptr<TcpConnection> c = weak.lock();
+        if (!c || c->getUserId() != userid) {
+            return;
+        }
+        _dbStrands->get(c->getFd()).post([this, c, userid, lastId, more]() {
+            _offlineMsgModel.remove(userid, lastId);
+            if (more) {
+                deliverOffline(c, userid, lastId);
+            }
+        });
+    });
+}
+
 // 处理客户端异常退出
 void ChatService::clientCloseException(const std::shared_ptr<TcpConnection>& conn) {
-    User user;
-    {
-        lock_guard<mutex> lock(_connMutex);
-        
-        for (auto it = _userConnMap.begin(); it != _userConnMap.end(); ++it) {
-            if (it->second == conn) {
-                // 找到了
-                user.setId(it->first);
-                // 从 map 移除
-                _userConnMap.erase(it);
-                break;
-            }
+    // [修改] 放到该连接的 DB strand 上执行：一是要访问 Redis，不能卡住 IO 线程；
+    // 二是排在这条连接还没处理完的登录之后，不会漏掉刚登录就断开的用户
+    _dbStrands->get(conn->getFd()).post([this, conn]() {
+        // [修改] 连接上记着用户 id，O(1) 定位，不再遍历整张表
+        int id = conn->getUserId();
+        if (id < 0 || !_userConns.erase(id, conn.get())) {
+            return; // 没登录过，或者登记的已经不是这条连接
         }
-    }
 
-    // 更新数据库状态
-    if (user.getId() != -1) { // 默认 id 是 -1, User 构造函数里没写，这里最好去 model 看看 User 初始化
-        user.setState("offline");
-        _userModel.updateState(user);
-        
-        // [新增] 用户下线，取消订阅
-        _redis.unsubscribe(user.getId());
-    }
+        // [修改] 从 Presence 里注销 (只删除仍然指向本节点的记录)
+        _presence.offline(id);
+    });
 }
 
 // 从 Redis 收到消息：说明有别的服务器发消息给本服务器上的用户了
 void ChatService::handleRedisSubscribeMessage(int userid, std::string msg) {
-    lock_guard<mutex> lock(_connMutex);
-    auto it = _userConnMap.find(userid);
-    if (it != _userConnMap.end()) {
-        it->second->send(ONE_CHAT_MSG, msg);
+    std::shared_ptr<TcpConnection> toConn = _userConns.find(userid);
+    if (toConn) {
+        toConn->send(ONE_CHAT_MSG, std::move(msg));
         return;
     }
 
     // 理论上如果订阅了该用户，意味着用户肯定在线。
     // 但可能正好用户下线了，消息刚到，这时候可以选择存离线，或者丢弃
     // 这里简单起见，存储离线消息
-    _offlineMsgModel.insert(userid, msg);
+    // [修改] 写库交给 DB 通道，不阻塞 Redis 的订阅线程
+    _dbStrands->get(userid).post([this, userid, msg = std::move(msg)]() {
+        _offlineMsgModel.insert(userid, msg);
+    });
+}
+
+// [新增] 发布到别的节点的消息没有订阅者收到：对方所在的节点已经不在了，存成离线消息
+void ChatService::handleRedisUndelivered(int userid, std::string msg) {
+    cout << "跨节点消息没有节点接收，转存离线消息 toid=" << userid << endl;
+    _dbStrands->get(userid).post([this, userid, msg = std::move(msg)]() {
+        _offlineMsgModel.insert(userid, msg);
+    });
 }
 
 // 一对一聊天业务
-void ChatService::oneChat(const std::shared_ptr<TcpConnection>& conn, std::string& data) {
+void ChatService::oneChat(const std::shared_ptr<TcpConnection>& conn, std::string_view data) {
     OneChatRequest req;
-    if (req.ParseFromString(data)) {
+    if (req.ParseFromArray(data.data(), static_cast<int>(data.size()))) {
         int toid = req.to_id();
-        int fromid = req.from_id();
-        string msg = req.msg();
-
-        {
-            lock_guard<mutex> lock(_connMutex);
-            auto it = _userConnMap.find(toid);
-            if (it != _userConnMap.end()) {
-                // 用户在线，转发消息
-                it->second->send(ONE_CHAT_MSG, data);
-                return;
-            } 
-        } // 锁在这里释放
-
-        // 查询数据库：用户虽然不在本服务器，但可能在其他服务器
-        // 这一步是分布式聊天的关键！
-        User user = _userModel.query(toid);
-        if (user.getState() == "online") {
-            // 用户状态是 online，但不在我的 _userConnMap 里
-            // 说明用户在别的服务器上 -> 发布消息到 Redis
-            _redis.publish(toid, data);
+        // [修改] 原样转发整个包，不需要再把 msg 字段单独拷一份出来 (这里跑在 IO 线程上)
+
+        // [修改] 分片注册表上只拿一个分片的读锁，不同接收者的转发互不阻塞
+        std::shared_ptr<TcpConnection> toConn = _userConns.find(toid);
+        if (toConn) {
+            // 用户在线，转发消息
+            toConn->send(ONE_CHAT_MSG, data);
             return;
         }
 
-        // 用户不在线 -> 存储离线消息
-        _offlineMsgModel.insert(toid, data);
+        // [修改] 后面要访问 Redis 或写库，转到 DB 通道执行，IO 线程不等它们
+        // 同一连接转到 DB 通道的消息之间保序；但和上面直接转发的消息之间不保序：
+        // 接收者刚好在两条消息之间登录到本机时，后一条 (直接转发) 可能比前一条 (还在 DB 通道排队) 先到。
+        // 只有接收者换位置的那一瞬间会发生，为此让在线转发也绕一次线程不划算
+        _dbStrands->get(conn->getFd()).post([this, toid, d = std::string(data)]() mutable {
+            forwardOrStore(toid, std::move(d));
+        });
     }
 }
 
+// [新增] 对方不在本机：看是在别的服务器上还是离线
+void ChatService::forwardOrStore(int toid, std::string data) {
+    // [修改] 用户虽然不在本服务器，但可能在其他服务器，这一步是分布式聊天的关键！
+    // 查的是 Presence 的本地镜像，不再每条消息 SELECT 一次 User 表
+    std::string node = _presence.locate(toid);
+    if (!node.empty() && node != _presence.nodeId()) {
+        // 用户在别的服务器上 -> 发布到那个节点的通道，接收者 id 放在信封里
+        if (_redis.publish(nodeChannel(node), toid, data)) {
+            return;
+        }
+        // [新增] 发布被拒绝 (没连上 Redis 或者发送队列积压满了)：不能悄悄丢掉，存成离线消息，对方下次登录时收到
+        cout << "跨节点转发失败，转存离线消息 toid=" << toid << endl;
+    }
+
+    // 用户不在线 -> 存储离线消息
+    _offlineMsgModel.insert(toid, data);
+}
+
 // [新增] 处理客户端心跳
-// 实际上这里不需要做太多业务逻辑，因为 TcpConnection::onRead 每次读到数据都会刷新 lastActiveTime
+// 实际上这里不需要做太多业务逻辑，因为 TcpConnection::onRead 每次读到数据都会在空闲时间轮上重新计时
 // 这里只是为了响应 MSGID，避免 "can not find handler" 报错
-void ChatService::clientHeartBeat(const std::shared_ptr<TcpConnection>& conn, std::string& data) {
+void ChatService::clientHeartBeat(const std::shared_ptr<TcpConnection>& conn, std::string_view data) {
     // printf("Heartbeat from fd=%d\n", conn->fd());
     // 可以在这里回复一个 HEART_BEAT_ACK，也可以不回复（单向心跳）
 }
@@ -0,0 +1,213 @@
+#include "server/model/OfflineMsgWriter.hpp"
+#include "server/model/SqlStatements.hpp"
+#include "db/ConnectionPool.h"
+#include <iostream>
+
+namespace {
+
+// 预编译语句的参数个数是固定的，所以多行插入按行数分档，每档一条语句；一批消息拆成若干档执行
+struct BatchStmt {
+    size_t rows;
+    StmtDef def;
+};
+
+std::string makeInsertSql(size_t rows) {
+    std::string sql = "INSERT INTO OfflineMessage(userid, message) VALUES";
+    for (size_t i = 0; i < rows; ++i) {
+        sql += (i == 0) ? "(?, ?)" : ", (?, ?)";
+    }
+    return sql;
+}
+
+// 从大到小排列，最后一档就是单行插入
+const std::vector<BatchStmt>& batchStmts() {
+    static const std::string sql4 = makeInsertSql(4);
+    static const std::string sql16 = makeInsertSql(16);
+    static const std::string sql64 = makeInsertSql(64);
+    static const std::vector<BatchStmt> stmts = {
+        {64, {STMT_OFFLINE_INSERT_64, sql64.c_str()}},
+        {16, {STMT_OFFLINE_INSERT_16, sql16.c_str()}},
+        {4, {STMT_OFFLINE_INSERT_4, sql4.c_str()}},
+        {1, kOfflineInsert},
+    };
+    return stmts;
+}
+
+} // namespace
+
+OfflineMsgWriter::OfflineMsgWriter()
+    : pending_(0),
+      inflight_(0),
+      connLost_(false),
+      orderKey_(0),
+      flushNow_(false),
+      stop_(false)
+{
+    thread_ = std::thread(&OfflineMsgWriter::run, this);
+}
+
+OfflineMsgWriter::~OfflineMsgWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wakeCv_.notify_one();
+    doneCv_.notify_all();
+    thread_.join();
+
+    // 已经提交的批次回调里还会访问本对象，等它们都回来
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCv_.wait_for(lock, std::chrono::milliseconds(kDrainTimeoutMs), [this]() { return inflight_ == 0; });
+}
+
+void OfflineMsgWriter::append(int userid, std::string msg, AckCallback ack) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 背压：数据库跟不上时让生产者慢下来，而不是让内存无限增长
+    doneCv_.wait(lock, [this]() { return pending_ < kMaxPending || stop_; });
+
+    if (rows_.empty()) {
+        firstAt_ = std::chrono::steady_clock::now();
+    }
+    rows_.push_back(Row{userid, std::move(msg), std::move(ack)});
+    ++pending_;
+    ++unacked_[userid];
+
+    // 第一条消息要让后台线程开始计时，攒够一批要让它立即提交
+    if (rows_.size() == 1 || rows_.size() >= kMaxBatch) {
+        wakeCv_.notify_one();
+    }
+}
+
+void OfflineMsgWriter::drain(int userid) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (unacked_.find(userid) == unacked_.end()) {
+        return;
+    }
+    flushNow_ = true;
+    wakeCv_.notify_one();
+    // 确认时计数归零的用户会从表里删掉，所以查不到就是都落库了
+    if (!doneCv_.wait_for(lock, std::chrono::milliseconds(kDrainTimeoutMs),
+                          [this, userid]() { return unacked_.find(userid) == unacked_.end() || stop_; })) {
+        std::cout << "等待离线消息落库超时 userid=" << userid << std::endl;
+    }
+}
+
+void OfflineMsgWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wakeCv_.wait(lock, [this]() { return !rows_.empty() || !retry_.empty() || stop_; });
+        if (rows_.empty() && retry_.empty()) {
+            return; // stop_ 且没有剩余
+        }
+
+        std::vector<Row> rows;
+        if (!retry_.empty()) {
+            // [新增] 有失败的批次：先等之前提交的批次都有结果 (它们失败了也会进 retry_)，
+            // 然后排在新消息前面一起重新提交，同一用户的消息不会乱序
+            wakeCv_.wait(lock, [this]() { return inflight_ == 0 || stop_; });
+            if (connLost_) {
+                // 连接断了：换下一条连接 (单连接时就是等它重连)，隔一会儿再提交，不让失败的请求空转
+                connLost_ = false;
+                ++orderKey_;
+                wakeCv_.wait_for(lock, std::chrono::milliseconds(kRetryDelayMs), [this]() { return stop_; });
+            }
+            rows.swap(retry_);
+            rows.insert(rows.end(), std::make_move_iterator(rows_.begin()), std::make_move_iterator(rows_.end()));
+            rows_.clear();
+        } else {
+            // 等够一批、时间窗口到了、有人要 drain 或者要退出，任一条件满足就提交
+            auto deadline = firstAt_ + std::chrono::milliseconds(kFlushWindowMs);
+            wakeCv_.wait_until(lock, deadline, [this]() {
+                return rows_.size() >= kMaxBatch || flushNow_ || stop_;
+            });
+            rows.swap(rows_);
+        }
+        flushNow_ = false;
+
+        lock.unlock();
+        submit(std::move(rows), orderKey_);
+        lock.lock();
+    }
+}
+
+void OfflineMsgWriter::submit(std::vector<Row> rows, int orderKey) {
+    const std::vector<BatchStmt>& stmts = batchStmts();
+    size_t begin = 0;
+    while (begin < rows.size()) {
+        // [修改] 按原来的顺序往后切：要单独执行的行一行一条语句，其余连续的行用放得下的最大一档
+        size_t count = 0;
+        while (begin + count < rows.size() && !rows[begin + count].single) {
+            ++count;
+        }
+        const BatchStmt* stmt = &stmts.back();
+        for (const BatchStmt& candidate : stmts) {
+            if (count >= candidate.rows) {
+                stmt = &candidate;
+                break;
+            }
+        }
+
+        // 参数里放的是拷贝，原始的消息跟着回调走，失败了还能重新提交
+        StmtParams params;
+        std::vector<Row> batch;
+        batch.reserve(stmt->rows);
+        for (size_t i = begin; i < begin + stmt->rows; ++i) {
+            params.addInt(rows[i].userid).addBlob(rows[i].msg);
+            batch.push_back(std::move(rows[i]));
+        }
+        begin += stmt->rows;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++inflight_;
+        }
+        ConnectionPool::getInstance()->asyncExecute(stmt->def, std::move(params),
+            [this, batch = std::move(batch)](bool ok, unsigned long long, bool connLost) mutable {
+                onBatchDone(batch, ok, connLost);
+            }, orderKey);
+    }
+}
+
+void OfflineMsgWriter::onBatchDone(std::vector<Row>& rows, bool ok, bool connLost) {
+    std::vector<AckCallback> acks;
+    {
+        // 在锁里通知：析构函数等到 inflight_ 归零就会返回，锁外通知可能碰到已经销毁的条件变量
+        std::lock_guard<std::mutex> lock(mutex_);
+        --inflight_;
+
+        // [修改] 连接断了整批重试；语句出错就拆成单行重试，单行还出错说明这一行本身有问题，不再重试
+        bool isolate = !ok && !connLost && rows.size() > 1;
+        if (!ok && !stop_ && (connLost || isolate)) {
+            std::cout << "离线消息批量写入失败, 条数: " << rows.size()
+                      << (connLost ? "，连接断开，稍后重试" : "，拆成单行重试") << std::endl;
+            for (Row& row : rows) {
+                row.single = row.single || isolate;
+            }
+            connLost_ = connLost_ || connLost;
+            retry_.insert(retry_.end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+            wakeCv_.notify_one();
+            return;
+        }
+
+        if (!ok) {
+            std::cout << (stop_ ? "退出时离线消息写入失败, 条数: " : "离线消息写入出错，丢弃, 条数: ")
+                      << rows.size() << std::endl;
+        }
+        pending_ -= rows.size();
+        for (Row& row : rows) {
+            auto it = unacked_.find(row.userid);
+            if (it != unacked_.end() && --it->second == 0) {
+                unacked_.erase(it);
+            }
+            if (row.ack) {
+                acks.push_back(std::move(row.ack));
+            }
+        }
+        doneCv_.notify_all();
+        wakeCv_.notify_one();
+    }
+
+    for (AckCallback& ack : acks) {
+        ack(ok);
+    }
+}
@@ -0,0 +1,65 @@
+#include "server/model/UserCache.hpp"
+
+UserCache::UserCache(size_t capacityPerShard, std::chrono::milliseconds ttl)
+    : capacityPerShard_(capacityPerShard == 0 ? 1 : capacityPerShard),
+      ttl_(ttl),
+      hits_(0),
+      misses_(0)
+{
+}
+
+bool UserCache::get(int userid, User& user) {
+    Shard& shard = shardOf(userid);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(userid);
+    if (it == shard.index.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (Clock::now() >= it->second->expireAt) {
+        // 过期了：直接删掉，由调用者重新查库再放回来
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 挪到链表头，只改指针不拷贝
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    user = it->second->user;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void UserCache::put(User user) {
+    int userid = user.getId();
+    Shard& shard = shardOf(userid);
+    Clock::time_point expireAt = Clock::now() + ttl_;
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(userid);
+    if (it != shard.index.end()) {
+        it->second->user = std::move(user);
+        it->second->expireAt = expireAt;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.push_front(Entry{userid, std::move(user), expireAt});
+    shard.index.emplace(userid, shard.lru.begin());
+    if (shard.lru.size() > capacityPerShard_) {
+        shard.index.erase(shard.lru.back().userid);
+        shard.lru.pop_back();
+    }
+}
+
+void UserCache::invalidate(int userid) {
+    Shard& shard = shardOf(userid);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(userid);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
@@ -1,4 +1,5 @@
 #include "server/model/UserModel.hpp"
+#include "server/model/SqlStatements.hpp"
 #include "db/ConnectionPool.h" // 引入连接池
 #include <iostream>
 
@@ -6,10 +7,9 @@ using namespace std;
 
 // 注册用户：即向 User 表插入一条数据
 bool UserModel::insert(User& user) {
-    // 1. 组装 SQL 语句
-    char sql[1024] = {0};
-    sprintf(sql, "INSERT INTO User(name, password, state) VALUES('%s', '%s', '%s')",
-            user.getName().c_str(), user.getPwd().c_str(), user.getState().c_str());
+    // 1. [修改] 参数走预编译语句的二进制协议，不再拼接 SQL (用户名里的引号不会破坏语句，也不会被注入)
+    StmtParams params;
+    params.addString(user.getName()).addString(user.getPwd()).addString(user.getState());
 
     // 2. 从连接池获取连接
     ConnectionPool* cp = ConnectionPool::getInstance();
@@ -17,9 +17,12 @@ bool UserModel::insert(User& user) {
 
     if (sp) {
         // 3. 执行 SQL
-        if (sp->update(sql)) {
+        unsigned long long insertId = 0;
+        if (sp->execute(kUserInsert, params, &insertId)) {
             // [修复] 获取插入成功的用户主键ID，赋值给 user 对象
-            user.setId(sp->getInsertId()); 
+            user.setId(static_cast<int>(insertId));
+            // [新增] 新 id 不应该有缓存，保险起见清掉
+            _cache.invalidate(user.getId());
             return true;
         }
     }
@@ -28,53 +31,30 @@ bool UserModel::insert(User& user) {
 
 // 查询用户
 User UserModel::query(int id) {
-    char sql[1024] = {0};
-    sprintf(sql, "SELECT * FROM User WHERE id = %d", id);
-
-    ConnectionPool* cp = ConnectionPool::getInstance();
-    shared_ptr<Connection> sp = cp->getConnection();
-
-    if (sp) {
-        MYSQL_RES* res = sp->query(sql);
-        if (res != nullptr) {
-            // 解析查询结果
-            MYSQL_ROW row = mysql_fetch_row(res);
-            if (row != nullptr) {
-                User user;
-                user.setId(atoi(row[0]));
-                user.setName(row[1]);
-                user.setPwd(row[2]);
-                user.setState(row[3]);
-                mysql_free_result(res); // 记得释放资源
-                return user;
-            }
-            mysql_free_result(res);
-        }
+    // [新增] 登录和跨服务器聊天都要查一次用户，热点用户直接命中缓存，不用每条消息都查库
+    User cached;
+    if (_cache.get(id, cached)) {
+        return cached;
     }
-    return User(); // 返回默认的无效用户
-}
 
-bool UserModel::updateState(User user) {
-    char sql[1024] = {0};
-    sprintf(sql, "UPDATE User SET state = '%s' WHERE id = %d", 
-            user.getState().c_str(), user.getId());
+    StmtParams params;
+    params.addInt(id);
 
     ConnectionPool* cp = ConnectionPool::getInstance();
     shared_ptr<Connection> sp = cp->getConnection();
 
     if (sp) {
-        if (sp->update(sql)) {
-            return true;
+        // [修改] 预编译查询，结果按列读取
+        StmtReader reader = sp->query(kUserQuery, params);
+        if (reader.next()) {
+            User user;
+            user.setId(static_cast<int>(reader.getInt(0)));
+            user.setName(reader.getString(1));
+            user.setPwd(reader.getString(2));
+            user.setState(reader.getString(3));
+            _cache.put(user);
+            return user;
         }
     }
-    return false;
+    return User(); // 返回默认的无效用户
 }
-
-void UserModel::resetState() {
-    char sql[1024] = "UPDATE User SET state = 'offline' WHERE state = 'online'";
-    ConnectionPool* cp = ConnectionPool::getInstance();
-    shared_ptr<Connection> sp = cp->getConnection();
-    if (sp) {
-        sp->update(sql);
-    }
-}
\ No newline at end of file
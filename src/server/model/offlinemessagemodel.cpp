@@ -1,80 +1,93 @@
 #include "server/model/offlinemessagemodel.hpp"
+#include "server/model/SqlStatements.hpp"
 #include "db/ConnectionPool.h"
 #include <iostream>
 #include <vector>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
-// 辅助函数：Binary -> Hex
-static std::string toHex(const std::string& input) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (unsigned char c : input) {
-        ss << std::setw(2) << static_cast<int>(c);
-    }
-    return ss.str();
+void OfflineMsgModel::insert(int userid, std::string msg, OfflineMsgWriter::AckCallback ack) {
+    // [修改] 不再每条消息单独 INSERT 一次，由写入器合并成多行插入
+    // message 列是 BLOB，protobuf 数据按原样绑定成二进制参数，不再转 Hex
+    _writer.append(userid, std::move(msg), std::move(ack));
 }
 
-// 辅助函数：Hex -> Binary
-static std::string fromHex(const std::string& input) {
-    if (input.length() % 2 != 0) return "";
-    std::string output;
-    output.reserve(input.length() / 2);
-    for (size_t i = 0; i < input.length(); i += 2) {
-        std::string byteString = input.substr(i, 2);
-        char byte = (char)strtol(byteString.c_str(), nullptr, 16);
-        output.push_back(byte);
-    }
-    return output;
+void OfflineMsgModel::remove(int userid, long long upToId) {
+    StmtParams params;
+    params.addInt(userid).addInt(upToId);
+
+    // [修改] 交给异步连接执行，业务线程不等数据库
+    ConnectionPool::getInstance()->asyncExecute(kOfflineRemove, std::move(params), nullptr, userid);
 }
 
-void OfflineMsgModel::insert(int userid, std::string msg) {
-    // 1. 将二进制 msg 转为 Hex 字符串，防止特殊字符破坏 SQL 且不受 \0 影响
-    std::string hexMsg = toHex(msg);
+std::vector<OfflineMsg> OfflineMsgModel::query(int userid, long long afterId, size_t limit) {
+    // [新增] 还在写入器里的消息先落库 ([修改] 只等这个用户的)
+    _writer.drain(userid);
 
-    // 2. 组装 SQL
-    char sql[10240] = {0}; // 扩大缓冲区，防止 overflow
-    sprintf(sql, "INSERT INTO OfflineMessage(userid, message) VALUES(%d, '%s')", 
-            userid, hexMsg.c_str());
+    StmtParams params;
+    params.addInt(userid).addInt(afterId).addInt(static_cast<long long>(limit));
 
+    std::vector<OfflineMsg> vec;
     ConnectionPool* cp = ConnectionPool::getInstance();
     std::shared_ptr<Connection> sp = cp->getConnection();
+
     if (sp) {
-        sp->update(sql);
+        StmtReader reader = sp->query(kOfflineQuery, params);
+        while (reader.next()) {
+            // [修改] 取出来就是原始的二进制数据，不用再解码
+            vec.push_back(OfflineMsg{reader.getInt(0), reader.getString(1)});
+        }
     }
+    return vec;
 }
 
-void OfflineMsgModel::remove(int userid) {
-    char sql[1024] = {0};
-    sprintf(sql, "DELETE FROM OfflineMessage WHERE userid=%d", userid);
-
-    ConnectionPool* cp = ConnectionPool::getInstance();
-    std::shared_ptr<Connection> sp = cp->getConnection();
-    if (sp) {
-        sp->update(sql);
+// [新增] 查询 OfflineMessage 表某一列的类型，列不存在时返回空串
+static std::string columnType(Connection& conn, const std::string& column) {
+    std::string type;
+    MYSQL_RES* res = conn.query("SELECT DATA_TYPE FROM information_schema.COLUMNS "
+                                "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'OfflineMessage' "
+                                "AND COLUMN_NAME = '" + column + "'");
+    if (res != nullptr) {
+        MYSQL_ROW row = mysql_fetch_row(res);
+        if (row != nullptr && row[0] != nullptr) {
+            type = row[0];
+        }
+        mysql_free_result(res);
     }
+    return type;
 }
 
-std::vector<std::string> OfflineMsgModel::query(int userid) {
-    char sql[1024] = {0};
-    sprintf(sql, "SELECT message FROM OfflineMessage WHERE userid = %d", userid);
-
-    std::vector<std::string> vec;
-    ConnectionPool* cp = ConnectionPool::getInstance();
-    std::shared_ptr<Connection> sp = cp->getConnection();
+void OfflineMsgModel::migrate() {
+    std::shared_ptr<Connection> sp = ConnectionPool::getInstance()->getConnection();
+    if (!sp) {
+        return;
+    }
 
-    if (sp) {
-        MYSQL_RES* res = sp->query(sql);
-        if (res != nullptr) {
-            MYSQL_ROW row;
-            while ((row = mysql_fetch_row(res)) != nullptr) {
-                 // 数据库存的是 Hex，需要转回 Binary
-                std::string hexMsg = row[0];
-                vec.push_back(fromHex(hexMsg));
-            }
-            mysql_free_result(res);
+    // 1. 旧版本的 message 是文本列，存的是 Hex 字符串：解码到新的 BLOB 列，再一条 ALTER 把新列换成 message
+    //    char/varchar/text/mediumtext ... 都是旧的文本列，其他 (blob/varbinary) 说明已经迁移过了
+    //    [修改] 每一步都可以重复执行：中途进程退出的话，下次启动时 message 仍是文本列，从断点接着做，
+    //    不会出现"列已经是 BLOB、内容还是 Hex"的状态
+    std::string type = columnType(*sp, "message");
+    if (type.find("char") != std::string::npos || type.find("text") != std::string::npos) {
+        std::cout << "迁移离线消息表: message 列 " << type << " -> BLOB" << std::endl;
+        if (columnType(*sp, "message_bin").empty()
+            && !sp->update("ALTER TABLE OfflineMessage ADD COLUMN message_bin BLOB NULL")) {
+            return;
+        }
+        // 只解码还没解码过的行；不是合法 Hex 的旧数据解出来是 NULL，按空消息处理
+        if (!sp->update("UPDATE OfflineMessage SET message_bin = COALESCE(UNHEX(message), '') "
+                        "WHERE message_bin IS NULL")) {
+            return;
+        }
+        if (sp->update("ALTER TABLE OfflineMessage DROP COLUMN message, "
+                       "CHANGE COLUMN message_bin message BLOB NOT NULL")) {
+            std::cout << "离线消息迁移完成" << std::endl;
         }
     }
-    return vec;
+
+    // 2. 分页投递要按消息 id 做游标：旧表没有 id 列就补上 (已有的行按物理顺序编号)
+    if (columnType(*sp, "id").empty()) {
+        std::cout << "迁移离线消息表: 增加 id 列" << std::endl;
+        sp->update("ALTER TABLE OfflineMessage ADD COLUMN id BIGINT NOT NULL AUTO_INCREMENT, "
+                   "ADD UNIQUE KEY uk_id (id), ADD INDEX idx_userid_id (userid, id)");
+    }
 }
\ No newline at end of file